@@ -0,0 +1,47 @@
+#pragma once
+
+// Standard includes
+// C++ Standard
+#include <limits>
+#include <stdexcept>
+// C Standard
+#include <cstdint>
+
+// Integer semantics of the generated code, shared by everything that evaluates programs without
+// running the assembly: 64-bit two's complement wrap-around, and idivq's faults reported as errors.
+namespace my_cpp {
+namespace arith {
+// A division that would make idivq fault. Engines stop the program with it; the partial
+// evaluator leaves the statement for run time instead.
+class Fault : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+inline int64_t Add(int64_t left, int64_t right) {
+    return static_cast<int64_t>(static_cast<uint64_t>(left) + static_cast<uint64_t>(right));
+}
+
+inline int64_t Sub(int64_t left, int64_t right) {
+    return static_cast<int64_t>(static_cast<uint64_t>(left) - static_cast<uint64_t>(right));
+}
+
+inline int64_t Mul(int64_t left, int64_t right) {
+    return static_cast<int64_t>(static_cast<uint64_t>(left) * static_cast<uint64_t>(right));
+}
+
+inline bool DivFaults(int64_t left, int64_t right) {
+    return right == 0 || (left == std::numeric_limits<int64_t>::min() && right == -1);
+}
+
+inline int64_t Div(int64_t left, int64_t right) {
+    if (right == 0) {
+        throw Fault("Division by zero");
+    }
+    if (DivFaults(left, right)) {
+        throw Fault("Division overflow");
+    }
+    return left / right;
+}
+}  // namespace arith
+}  // namespace my_cpp
@@ -41,15 +41,15 @@ T ASTNode::GetValue() const {
 template size_t ASTNode::GetValue<size_t>() const;
 template int ASTNode::GetValue<int>() const;
 
-std::shared_ptr<ASTNode> ASTNode::GetLeft() const {
+const std::shared_ptr<ASTNode> &ASTNode::GetLeft() const {
     return left_;
 }
 
-std::shared_ptr<ASTNode> ASTNode::GetMiddle() const {
+const std::shared_ptr<ASTNode> &ASTNode::GetMiddle() const {
     return middle_;
 }
 
-std::shared_ptr<ASTNode> ASTNode::GetRight() const {
+const std::shared_ptr<ASTNode> &ASTNode::GetRight() const {
     return right_;
 }
 
@@ -42,9 +42,9 @@ public:
     Type GetType() const;
     template <typename T>
     T GetValue() const;
-    std::shared_ptr<ASTNode> GetLeft() const;
-    std::shared_ptr<ASTNode> GetMiddle() const;
-    std::shared_ptr<ASTNode> GetRight() const;
+    const std::shared_ptr<ASTNode> &GetLeft() const;
+    const std::shared_ptr<ASTNode> &GetMiddle() const;
+    const std::shared_ptr<ASTNode> &GetRight() const;
     Type GetOp() const;
 
     static std::shared_ptr<ASTNode> MakeAstNode(
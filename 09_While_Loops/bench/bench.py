@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Benchmarks for the compiler and its execution engines.
+
+    bench.py <build_dir> [<benchmark> ...] [--repeat <runs>] [--scale <factor>]
+
+Each benchmark generates its programs with programs.py, runs them with the build directory's
+my_cpp or a bench_* helper built next to it, and prints a table. Times are wall-clock seconds,
+the best of --repeat runs; --scale multiplies every program size. Use a Release build. With no
+benchmark named, all of them run.
+"""
+import argparse
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+
+import programs
+
+
+class Harness:
+    def __init__(self, build_dir, repeat, scale):
+        self.build_dir = os.path.abspath(build_dir)
+        self.repeat = repeat
+        self.scale = scale
+        self.directory = tempfile.TemporaryDirectory(prefix="bench")
+        self.work = self.directory.name
+
+    def tool(self, name):
+        path = os.path.join(self.build_dir, name)
+        if not os.path.exists(path):
+            sys.exit("%s not found; build the project in %s first" % (name, self.build_dir))
+        return path
+
+    def size(self, n):
+        return max(1, int(n * self.scale))
+
+    def write(self, name, text):
+        path = os.path.join(self.work, name)
+        with open(path, "w") as source:
+            source.write(text)
+        return path
+
+    def run(self, command):
+        """Runs a command in the work directory and returns its stdout; it must succeed."""
+        result = subprocess.run(command, cwd=self.work, capture_output=True, text=True)
+        if result.returncode != 0:
+            sys.exit("%s failed:\n%s" % (" ".join(command), result.stderr))
+        return result.stdout
+
+    def time(self, command):
+        best = None
+        for _ in range(self.repeat):
+            begin = time.perf_counter()
+            self.run(command)
+            elapsed = time.perf_counter() - begin
+            best = elapsed if best is None else min(best, elapsed)
+        return best
+
+
+def table(header, rows):
+    widths = [max(len(str(row[i])) for row in [header] + rows) for i in range(len(header))]
+    for row in [header] + rows:
+        print("  ".join(str(cell).rjust(width) for cell, width in zip(row, widths)))
+    print()
+
+
+def bench_symbols(harness):
+    """SymbolTable inserts and lookups up to millions of symbols, then whole programs of globals."""
+    sizes = [harness.size(n) for n in (1000000, 2000000, 4000000, 8000000)]
+    print(harness.run([harness.tool("bench_symbols")] + [str(n) for n in sizes]))
+    rows = []
+    for n in (harness.size(n) for n in (125000, 250000, 500000, 1000000)):
+        program = harness.write("globals%d.txt" % n, programs.globals_program(n))
+        seconds = harness.time([harness.tool("my_cpp"), "--run", program])
+        rows.append([n, "%.2f" % seconds, "%.2f" % (seconds / n * 1e6)])
+    table(["globals", "--run s", "us/global"], rows)
+
+
+# The in-process engines compared by the engines benchmark; --run is the tree walker.
+ENGINES = ["--run", "--vm", "--closure"]
+
+
+def bench_engines(harness):
+    """utility::Evaluate and the engines on expressions, then the engines on loop kernels."""
+    sizes = [harness.size(n) for n in (1000, 100000, 1000000)]
+    print(harness.run([harness.tool("bench_evaluate")] + [str(n) for n in sizes]))
+    rows = []
+    for name, text in programs.loop_programs(harness.size(10000000)).items():
+        program = harness.write(name + ".txt", text)
+        times = [harness.time([harness.tool("my_cpp"), engine, program]) for engine in ENGINES]
+        rows.append([name] + ["%.3f" % seconds for seconds in times]
+                    + ["%.1fx" % (times[0] / seconds) for seconds in times[1:]])
+    table(["program"] + [engine + " s" for engine in ENGINES]
+          + [engine + " speedup" for engine in ENGINES[1:]], rows)
+
+
+def bench_codegen(harness):
+    """x86 code generation throughput on a 240k-statement program, optimized and with -O0."""
+    n = harness.size(240000)
+    program = harness.write("straight%d.txt" % n, programs.straight_line_program(n))
+    rows = []
+    for flags in ([], ["-O0"]):
+        seconds = harness.time([harness.tool("my_cpp")] + flags + [program])
+        assembly = os.path.join(harness.work, "out.s")
+        with open(assembly) as output:
+            lines = sum(1 for _ in output)
+        megabytes = os.path.getsize(assembly) / 1e6
+        rows.append([" ".join(flags) or "default", n, "%.2f" % seconds, lines,
+                     "%.1f" % (megabytes / seconds), "%.0f" % (n / seconds / 1000)])
+    table(["flags", "statements", "seconds", "asm lines", "asm MB/s", "kstmt/s"], rows)
+
+
+def innermost_loops(assembly):
+    """The instruction count of each innermost loop in the assembly, in program order: from a
+    label to the last jump back to it, with no other loop head in between."""
+    lines = assembly.splitlines()
+    labels = {line[:-1]: index for index, line in enumerate(lines)
+              if line.startswith(".L") and line.endswith(":")}
+    back_edges = {}
+    for index, line in enumerate(lines):
+        parts = line.split()
+        if line.startswith("\tj") and len(parts) == 2 and labels.get(parts[1], index) < index:
+            back_edges[labels[parts[1]]] = index
+    counts = []
+    for head, back in sorted(back_edges.items()):
+        if any(head < other < back for other in back_edges):
+            continue
+        counts.append(sum(1 for line in lines[head + 1:back + 1]
+                          if line.startswith("\t") and not line.startswith("\t.")))
+    return counts
+
+
+def bench_licm(harness):
+    """Instructions per iteration of the innermost loops, and run time, with --no-licm and LICM."""
+    samples = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "samples")
+    inputs = [
+        ("input08", os.path.join(samples, "input08")),
+        ("invariant", harness.write("invariant.txt",
+                                    programs.invariant_program(harness.size(100000000)))),
+    ]
+    cc = os.environ.get("CC", "cc")
+    rows = []
+    for name, program in inputs:
+        row = [name]
+        for flags in (["--no-licm"], []):
+            harness.run([harness.tool("my_cpp")] + flags + [program])
+            with open(os.path.join(harness.work, "out.s")) as output:
+                row.append(", ".join(map(str, innermost_loops(output.read()))))
+            harness.run([cc, "-o", "a.out", "out.s"])
+            row.append("%.3f" % harness.time([os.path.join(harness.work, "a.out")]))
+        rows.append(row)
+    table(["program", "--no-licm instrs", "s", "licm instrs", "s"], rows)
+
+
+BENCHMARKS = {
+    "symbols": bench_symbols,
+    "engines": bench_engines,
+    "codegen": bench_codegen,
+    "licm": bench_licm,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(
+            description=__doc__ + "\nbenchmarks:\n" + "\n".join(
+                    "  %-10s %s" % (name, function.__doc__)
+                    for name, function in BENCHMARKS.items()),
+            formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("build_dir")
+    parser.add_argument("benchmarks", nargs="*")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--scale", type=float, default=1.0)
+    args = parser.parse_args()
+    for name in args.benchmarks:
+        if name not in BENCHMARKS:
+            parser.error("unknown benchmark %s" % name)
+    # The statement lists of the large programs are deep trees, which the compiler walks
+    # recursively.
+    _, hard = resource.getrlimit(resource.RLIMIT_STACK)
+    resource.setrlimit(resource.RLIMIT_STACK, (hard, hard))
+    harness = Harness(args.build_dir, args.repeat, args.scale)
+    for name in args.benchmarks or BENCHMARKS:
+        print("== %s" % name)
+        BENCHMARKS[name](harness)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,93 @@
+#include "../ast.hpp"
+#include "../closure.hpp"
+#include "../context.hpp"
+#include "../gen_bytecode.hpp"
+#include "../interp.hpp"
+#include "../vm.hpp"
+
+// Standard includes
+// C++ Standard
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <ostream>
+// C Standard
+#include <cstdlib>
+
+namespace {
+using my_cpp::ASTNode;
+
+// A balanced tree of additions and subtractions over products of small literals, so that neither
+// int overflow nor the recursion depth limits the size. `leaves` is rounded up to a power of two.
+std::shared_ptr<ASTNode> expression(size_t leaves, size_t &next) {
+    if (leaves <= 2) {
+        const auto kLiteral = [&next] {
+            auto value = std::make_unique<my_cpp::Value>();
+            value->int_value_ = static_cast<int>(next++ % 3 + 1);
+            return ASTNode::MakeAstLeaf(ASTNode::Type::A_INTLIT, std::move(value));
+        };
+        auto left = kLiteral();
+        return ASTNode::MakeAstNode(ASTNode::Type::A_MULTIPLY, left, nullptr, kLiteral());
+    }
+    auto left = expression(leaves / 2, next);
+    auto right = expression(leaves / 2, next);
+    const auto kOp = next % 2 == 0 ? ASTNode::Type::A_ADD : ASTNode::Type::A_SUBTRACT;
+    return ASTNode::MakeAstNode(kOp, left, nullptr, right);
+}
+}  // namespace
+
+// Times one `print <expression>;` of each size given on the command line under the original
+// expression evaluator utility::Evaluate, the --run tree walker, the --vm bytecode machine and
+// the --closure engine; compiling for the last two is not counted. Prints one line per size with
+// the nanoseconds per AST node.
+// utility::Evaluate logs every node to std::cout, which has no buffer while it runs, so that the
+// writes fail without formatting anything.
+int main(int argc, char *argv[]) {
+    using Clock = std::chrono::steady_clock;
+    const auto kNanoseconds = [](Clock::time_point begin, size_t nodes) {
+        const std::chrono::duration<double, std::nano> kElapsed = Clock::now() - begin;
+        return kElapsed.count() / static_cast<double>(nodes);
+    };
+    std::ostream discard(nullptr);
+    std::printf("%10s %12s %12s %12s %12s\n", "nodes", "Evaluate ns", "--run ns", "--vm ns",
+                "--closure ns");
+    for (int i = 1; i < argc; ++i) {
+        size_t leaves = 2;
+        while (leaves < std::strtoull(argv[i], nullptr, 10)) {
+            leaves *= 2;
+        }
+        size_t next = 0;
+        const auto kRoot = ASTNode::MakeAstUnary(ASTNode::Type::A_PRINT, expression(leaves, next));
+        const size_t kNodes = 2 * leaves - 1;
+
+        auto *const kStdout = std::cout.rdbuf(nullptr);
+        auto begin = Clock::now();
+        my_cpp::utility::Evaluate(*kRoot->GetLeft());
+        const double kEvaluate = kNanoseconds(begin, kNodes);
+        std::cout.rdbuf(kStdout);
+        std::cout.clear();
+
+        my_cpp::CompilationContext context;
+        my_cpp::Interpreter interpreter(context, discard);
+        begin = Clock::now();
+        interpreter.Run(*kRoot);
+        const double kRun = kNanoseconds(begin, kNodes);
+
+        my_cpp::CodeGeneratorBytecode codegen(context, discard);
+        codegen.GenerateCode(*kRoot);
+        my_cpp::VirtualMachine vm(discard);
+        begin = Clock::now();
+        vm.Run(codegen.GetBytecode());
+        const double kVm = kNanoseconds(begin, kNodes);
+
+        my_cpp::ClosureProgram program(context, *kRoot, discard);
+        begin = Clock::now();
+        program.Run();
+        const double kClosure = kNanoseconds(begin, kNodes);
+
+        std::printf("%10zu %12.1f %12.1f %12.1f %12.1f\n", kNodes, kEvaluate, kRun, kVm,
+                    kClosure);
+    }
+    return 0;
+}
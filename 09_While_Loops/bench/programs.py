@@ -0,0 +1,116 @@
+"""Program generators for bench.py. Each returns the source text of a program whose size grows
+with `n`. The language has no parentheses, no unary minus, and comparisons bind tighter than any
+arithmetic, so conditions compare single operands.
+"""
+import random
+
+
+def globals_program(n):
+    """n globals, each declared, assigned from the one before it, and the last one printed."""
+    lines = ["{"]
+    lines += ["int v%d;" % i for i in range(n)]
+    lines.append("v0 = 1;")
+    lines += ["v%d = v%d + 1;" % (i, i - 1) for i in range(1, n)]
+    lines.append("print v%d;" % (n - 1))
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def loop_programs(n):
+    """Loop-heavy kernels of about n inner iterations each, by name."""
+    outer = max(1, n // 1000)
+    nested = """{
+    int i; int j; int s;
+    s = 0;
+    i = 0;
+    while (i < %d) {
+        j = 0;
+        while (j < 1000) {
+            s = s + i * j - s / 7;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    print s;
+}
+""" % outer
+    # Collatz step counts: a data-dependent branch and a division in every iteration.
+    branches = """{
+    int i; int x; int steps; int half; int even;
+    steps = 0;
+    i = 1;
+    while (steps < %d) {
+        x = i;
+        while (x != 1) {
+            half = x / 2;
+            even = half * 2;
+            if (even == x) {
+                x = half;
+            } else {
+                x = x * 3 + 1;
+            }
+            steps = steps + 1;
+        }
+        i = i + 1;
+    }
+    print i;
+    print steps;
+}
+""" % n
+    # Locals in a nested block and a loop-carried pair of values.
+    locals_ = """{
+    int i;
+    i = 0;
+    while (i < %d) {
+        int a; int b; int t; int k;
+        a = 0;
+        b = 1;
+        k = 0;
+        while (k < 1000) {
+            t = a + b;
+            a = b;
+            b = t - a / 3;
+            k = k + 1;
+        }
+        print b;
+        i = i + 1;
+    }
+}
+""" % outer
+    return {"nested": nested, "branches": branches, "locals": locals_}
+
+
+def straight_line_program(n, seed=0):
+    """n statements of straight-line arithmetic on three globals, every sixth one an if/else."""
+    rng = random.Random(seed)
+    lines = ["{", "int a; int b; int c;", "a = 1; b = 2; c = 3;"]
+    for i in range(n):
+        if i % 6 == 0:
+            lines.append("if (a < b) { print a; } else { c = c + 1; }")
+        else:
+            lines.append("a = a + b * %d - c / %d;" % (rng.randint(1, 9), rng.randint(1, 9)))
+    lines.append("print a;")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def invariant_program(n):
+    """Nested loops of about n inner iterations whose inner body mostly depends on the outer
+    counter alone."""
+    limit = max(1, int(n ** 0.5))
+    return """{
+    int i; int j; int s; int limit;
+    i = 0;
+    s = 0;
+    limit = %d;
+    while (i < limit) {
+        j = 0;
+        while (j < limit) {
+            s = s + i * i * 3 + i / 7 - j;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    print s;
+}
+""" % limit
@@ -0,0 +1,56 @@
+#include "../symbols.hpp"
+
+// Standard includes
+// C++ Standard
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+// C Standard
+#include <cstdlib>
+
+// Times SymbolTable on its own at each size given on the command line: declaring that many
+// globals, finding every one of them, and declaring them all again, which finds the existing
+// entries. Prints one line per size with the nanoseconds per operation.
+int main(int argc, char *argv[]) {
+    using Clock = std::chrono::steady_clock;
+    const auto kNanoseconds = [](Clock::time_point begin, size_t operations) {
+        const std::chrono::duration<double, std::nano> kElapsed = Clock::now() - begin;
+        return kElapsed.count() / static_cast<double>(operations);
+    };
+    std::printf("%10s %10s %10s %10s\n", "symbols", "add ns", "find ns", "re-add ns");
+    for (int i = 1; i < argc; ++i) {
+        const size_t kCount = std::strtoull(argv[i], nullptr, 10);
+        std::vector<std::string> names(kCount);
+        for (size_t id = 0; id < kCount; ++id) {
+            names[id] = "v" + std::to_string(id);
+        }
+
+        my_cpp::SymbolTable table;
+        auto begin = Clock::now();
+        for (const auto &name : names) {
+            table.Add(name);
+        }
+        const double kAdd = kNanoseconds(begin, kCount);
+
+        size_t checksum = 0;
+        begin = Clock::now();
+        for (const auto &name : names) {
+            checksum += table.Find(name);
+        }
+        const double kFind = kNanoseconds(begin, kCount);
+
+        begin = Clock::now();
+        for (const auto &name : names) {
+            checksum -= table.Add(name);
+        }
+        const double kReAdd = kNanoseconds(begin, kCount);
+
+        if (checksum != 0 || table.Size() != kCount) {
+            std::fprintf(stderr, "SymbolTable lost symbols\n");
+            return 1;
+        }
+        std::printf("%10zu %10.1f %10.1f %10.1f\n", kCount, kAdd, kFind, kReAdd);
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+// Standard includes
+// C++ Standard
+#include <ostream>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Register-machine bytecode executed by VirtualMachine. Registers are unbounded 64-bit values;
+// variables live in numbered slots (globals by symbol id, locals after them by frame offset).
+enum class Opcode : uint8_t {
+    kLoadInt,  // a = imm(b)
+    kLoad,     // a = slot[b]
+    kStore,    // slot[b] = a
+    kAdd,      // a = b + c
+    kSub,      // a = b - c
+    kMul,      // a = b * c
+    kDiv,      // a = b / c
+    kEq,       // a = b == c
+    kNe,       // a = b != c
+    kLt,       // a = b < c
+    kGt,       // a = b > c
+    kLe,       // a = b <= c
+    kGe,       // a = b >= c
+    kJumpEq,   // if (a == b) goto c
+    kJumpNe,   // if (a != b) goto c
+    kJumpLt,   // if (a < b) goto c
+    kJumpGt,   // if (a > b) goto c
+    kJumpLe,   // if (a <= b) goto c
+    kJumpGe,   // if (a >= b) goto c
+    kJump,     // goto c
+    kPrint,    // print a
+    kHalt,
+};
+
+struct Instruction {
+    Opcode op;
+    uint16_t a;
+    int32_t b;
+    int32_t c;
+};
+
+struct Bytecode {
+    std::vector<Instruction> code;
+    size_t num_registers = 0;
+    size_t num_slots = 0;
+};
+}  // namespace my_cpp
+std::ostream &operator<<(std::ostream &os, const my_cpp::Bytecode &bytecode);
@@ -0,0 +1,302 @@
+#include "closure.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+#include <stdexcept>
+#include <utility>
+// C Standard
+
+namespace my_cpp {
+namespace {
+struct AddOp {
+    static int64_t Apply(int64_t left, int64_t right) {
+        return arith::Add(left, right);
+    }
+};
+struct SubOp {
+    static int64_t Apply(int64_t left, int64_t right) {
+        return arith::Sub(left, right);
+    }
+};
+struct MulOp {
+    static int64_t Apply(int64_t left, int64_t right) {
+        return arith::Mul(left, right);
+    }
+};
+struct DivOp {
+    static int64_t Apply(int64_t left, int64_t right) {
+        return arith::Div(left, right);
+    }
+};
+struct EqOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left == right;
+    }
+};
+struct NeOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left != right;
+    }
+};
+struct LtOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left < right;
+    }
+};
+struct GtOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left > right;
+    }
+};
+struct LeOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left <= right;
+    }
+};
+struct GeOp {
+    static bool Apply(int64_t left, int64_t right) {
+        return left >= right;
+    }
+};
+
+// Calls `f` with a default-constructed operation tag for `op`.
+template <typename F>
+auto with_operation(ASTNode::Type op, F &&f) {
+    switch (op) {
+    case ASTNode::Type::A_ADD:
+        return f(AddOp{});
+    case ASTNode::Type::A_SUBTRACT:
+        return f(SubOp{});
+    case ASTNode::Type::A_MULTIPLY:
+        return f(MulOp{});
+    case ASTNode::Type::A_DIVIDE:
+        return f(DivOp{});
+    case ASTNode::Type::A_EQ:
+        return f(EqOp{});
+    case ASTNode::Type::A_NE:
+        return f(NeOp{});
+    case ASTNode::Type::A_LT:
+        return f(LtOp{});
+    case ASTNode::Type::A_GT:
+        return f(GtOp{});
+    case ASTNode::Type::A_LE:
+        return f(LeOp{});
+    case ASTNode::Type::A_GE:
+        return f(GeOp{});
+    default:
+        throw std::runtime_error("Invalid ASTNode type");
+    }
+}
+
+bool is_variable(const ASTNode &node) {
+    return node.GetOp() == ASTNode::Type::A_IDENT;
+}
+
+bool is_constant(const ASTNode &node) {
+    return node.GetOp() == ASTNode::Type::A_INTLIT;
+}
+
+bool is_comparison(const ASTNode &node) {
+    return ASTNode::Type::A_EQ <= node.GetOp() && node.GetOp() <= ASTNode::Type::A_GE;
+}
+}  // namespace
+
+ClosureProgram::ClosureProgram(
+        const CompilationContext &context,
+        const ASTNode &root,
+        std::ostream &os)
+    : output_(os), slots_(context.GetSymbolTable().Size(), 0) {
+    program_ = compile_stmt(root);
+}
+
+void ClosureProgram::Run() {
+    if (program_) {
+        program_();
+    }
+    output_.Flush();
+}
+
+ClosureProgram::Stmt ClosureProgram::compile_stmt(const ASTNode &node) {
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_GLUE:
+        return compile_sequence(node);
+    case ASTNode::Type::A_ASSIGN:
+        return compile_assign(node);
+    case ASTNode::Type::A_PRINT: {
+        auto value = compile_expr(*node.GetLeft());
+        return [this, value = std::move(value)]() { output_.PrintInt(value()); };
+    }
+    case ASTNode::Type::A_IF: {
+        auto cond = compile_cond(*node.GetLeft());
+        Stmt then_stmt = node.GetMiddle() != nullptr ? compile_stmt(*node.GetMiddle()) : nullptr;
+        Stmt else_stmt = node.GetRight() != nullptr ? compile_stmt(*node.GetRight()) : nullptr;
+        if (!else_stmt) {
+            return [cond = std::move(cond), then_stmt = std::move(then_stmt)]() {
+                if (cond() && then_stmt) {
+                    then_stmt();
+                }
+            };
+        }
+        return [cond = std::move(cond),
+                then_stmt = std::move(then_stmt),
+                else_stmt = std::move(else_stmt)]() {
+            if (cond()) {
+                if (then_stmt) {
+                    then_stmt();
+                }
+            } else {
+                else_stmt();
+            }
+        };
+    }
+    case ASTNode::Type::A_WHILE:
+        return compile_while(node);
+    case ASTNode::Type::A_VAR_DECL: {
+        // Every declaration starts the variable at 0, as the compiled code does.
+        int64_t *variable = slot(node);
+        return [variable]() { *variable = 0; };
+    }
+    default:
+        throw std::runtime_error("Invalid statement");
+    }
+}
+
+// A chain of A_GLUE nodes becomes one flat list instead of a closure per glue node.
+ClosureProgram::Stmt ClosureProgram::compile_sequence(const ASTNode &node) {
+    std::vector<const ASTNode *> pending = {&node};
+    std::vector<Stmt> stmts;
+    while (!pending.empty()) {
+        const ASTNode *current = pending.back();
+        pending.pop_back();
+        if (current->GetOp() == ASTNode::Type::A_GLUE) {
+            if (current->GetRight() != nullptr) {
+                pending.push_back(current->GetRight().get());
+            }
+            if (current->GetLeft() != nullptr) {
+                pending.push_back(current->GetLeft().get());
+            }
+        } else if (auto stmt = compile_stmt(*current)) {
+            stmts.push_back(std::move(stmt));
+        }
+    }
+    return [stmts = std::move(stmts)]() {
+        for (const auto &stmt : stmts) {
+            stmt();
+        }
+    };
+}
+
+ClosureProgram::Stmt ClosureProgram::compile_assign(const ASTNode &node) {
+    int64_t *target = slot(*node.GetRight());
+    const auto &value = *node.GetLeft();
+    if (is_constant(value)) {
+        const int64_t kValue = value.GetValue<int>();
+        return [target, kValue]() { *target = kValue; };
+    }
+    if (is_variable(value)) {
+        const int64_t *source = slot(value);
+        return [target, source]() { *target = *source; };
+    }
+    // x = x <op> k, the shape of every loop counter update.
+    if (value.GetLeft() != nullptr && value.GetRight() != nullptr && is_variable(*value.GetLeft())
+        && slot(*value.GetLeft()) == target && is_constant(*value.GetRight())) {
+        const int64_t kValue = value.GetRight()->GetValue<int>();
+        return with_operation(value.GetOp(), [target, kValue](auto op) -> Stmt {
+            using Op = decltype(op);
+            return [target, kValue]() { *target = Op::Apply(*target, kValue); };
+        });
+    }
+    auto expr = compile_expr(value);
+    return [target, expr = std::move(expr)]() { *target = expr(); };
+}
+
+ClosureProgram::Stmt ClosureProgram::compile_while(const ASTNode &node) {
+    Stmt body = node.GetRight() != nullptr ? compile_stmt(*node.GetRight()) : nullptr;
+    if (!body) {
+        body = []() {};
+    }
+    const auto &cond = *node.GetLeft();
+    // The condition is inlined into the loop when it compares a variable with a constant.
+    if (is_comparison(cond) && is_variable(*cond.GetLeft()) && is_constant(*cond.GetRight())) {
+        const int64_t *value = slot(*cond.GetLeft());
+        const int64_t kLimit = cond.GetRight()->GetValue<int>();
+        return with_operation(cond.GetOp(), [value, kLimit, &body](auto op) -> Stmt {
+            using Op = decltype(op);
+            return [value, kLimit, body = std::move(body)]() {
+                while (Op::Apply(*value, kLimit)) {
+                    body();
+                }
+            };
+        });
+    }
+    auto test = compile_cond(cond);
+    return [test = std::move(test), body = std::move(body)]() {
+        while (test()) {
+            body();
+        }
+    };
+}
+
+ClosureProgram::Expr ClosureProgram::compile_expr(const ASTNode &node) {
+    if (is_constant(node)) {
+        const int64_t kValue = node.GetValue<int>();
+        return [kValue]() { return kValue; };
+    }
+    if (is_variable(node)) {
+        const int64_t *value = slot(node);
+        return [value]() { return *value; };
+    }
+    return with_operation(node.GetOp(), [this, &node](auto op) {
+        return compile_binary<decltype(op), int64_t>(node);
+    });
+}
+
+ClosureProgram::Cond ClosureProgram::compile_cond(const ASTNode &node) {
+    if (!is_comparison(node)) {
+        auto value = compile_expr(node);
+        return [value = std::move(value)]() { return value() != 0; };
+    }
+    return with_operation(node.GetOp(), [this, &node](auto op) {
+        return compile_binary<decltype(op), bool>(node);
+    });
+}
+
+// One closure per combination of operand shapes; variables are read straight from their slot
+// and constants are captured by value.
+template <typename Op, typename Result>
+std::function<Result()> ClosureProgram::compile_binary(const ASTNode &node) {
+    const auto &left = *node.GetLeft();
+    const auto &right = *node.GetRight();
+    if (is_variable(left) && is_variable(right)) {
+        const int64_t *a = slot(left);
+        const int64_t *b = slot(right);
+        return [a, b]() -> Result { return Op::Apply(*a, *b); };
+    }
+    if (is_variable(left) && is_constant(right)) {
+        const int64_t *a = slot(left);
+        const int64_t kB = right.GetValue<int>();
+        return [a, kB]() -> Result { return Op::Apply(*a, kB); };
+    }
+    if (is_constant(left) && is_variable(right)) {
+        const int64_t kA = left.GetValue<int>();
+        const int64_t *b = slot(right);
+        return [kA, b]() -> Result { return Op::Apply(kA, *b); };
+    }
+    auto a = compile_expr(left);
+    if (is_constant(right)) {
+        const int64_t kB = right.GetValue<int>();
+        return [a = std::move(a), kB]() -> Result { return Op::Apply(a(), kB); };
+    }
+    if (is_variable(right)) {
+        const int64_t *b = slot(right);
+        return [a = std::move(a), b]() -> Result { return Op::Apply(a(), *b); };
+    }
+    auto b = compile_expr(right);
+    return [a = std::move(a), b = std::move(b)]() -> Result { return Op::Apply(a(), b()); };
+}
+
+int64_t *ClosureProgram::slot(const ASTNode &node) {
+    return &slots_[node.GetValue<size_t>()];
+}
+}  // namespace my_cpp
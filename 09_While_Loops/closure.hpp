@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ast.hpp"
+#include "context.hpp"
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <functional>
+#include <ostream>
+#include <vector>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+// Closure compilation: every AST node is turned, once, into a C++ callable specialised on the
+// shape of its operands (variable, constant or sub-expression), so running the program needs
+// neither the per-node switch of a tree walker nor any walking of the shared_ptr tree.
+class ClosureProgram {
+public:
+    ClosureProgram(const CompilationContext &context, const ASTNode &root, std::ostream &os);
+    ClosureProgram(const ClosureProgram &) = delete;
+    ClosureProgram &operator=(const ClosureProgram &) = delete;
+    void Run();
+
+private:
+    using Expr = std::function<int64_t()>;
+    using Cond = std::function<bool()>;
+    using Stmt = std::function<void()>;
+
+    OutputBuffer output_;
+    // Indexed by symbol id. Never resized after construction: closures hold pointers into it.
+    std::vector<int64_t> slots_;
+    Stmt program_;
+
+    Stmt compile_stmt(const ASTNode &node);
+    Stmt compile_sequence(const ASTNode &node);
+    Stmt compile_assign(const ASTNode &node);
+    Stmt compile_while(const ASTNode &node);
+    Expr compile_expr(const ASTNode &node);
+    Cond compile_cond(const ASTNode &node);
+
+    template <typename Op, typename Result>
+    std::function<Result()> compile_binary(const ASTNode &node);
+
+    int64_t *slot(const ASTNode &node);
+};
+}  // namespace my_cpp
@@ -0,0 +1,40 @@
+#include "context.hpp"
+// Standard includes
+// C++ Standard
+// C Standard
+
+namespace my_cpp {
+SymbolTable &CompilationContext::GetSymbolTable() {
+    return symbol_table_;
+}
+
+const SymbolTable &CompilationContext::GetSymbolTable() const {
+    return symbol_table_;
+}
+
+size_t CompilationContext::NewLabel() {
+    return label_id_++;
+}
+
+void CompilationContext::AddDiagnostic(const std::string &message) {
+    diagnostics_.push_back(message);
+}
+
+const std::vector<std::string> &CompilationContext::GetDiagnostics() const {
+    return diagnostics_;
+}
+
+void CompilationContext::AddStatistic(const std::string &name, size_t value) {
+    for (auto &statistic : statistics_) {
+        if (statistic.first == name) {
+            statistic.second += value;
+            return;
+        }
+    }
+    statistics_.emplace_back(name, value);
+}
+
+const std::vector<std::pair<std::string, size_t>> &CompilationContext::GetStatistics() const {
+    return statistics_;
+}
+}  // namespace my_cpp
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "symbols.hpp"
+// Standard includes
+// C++ Standard
+#include <string>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+// Everything one compilation mutates. Nothing in the compiler keeps process-wide state, so any
+// number of contexts can be used concurrently as long as each one stays on a single thread.
+class CompilationContext {
+public:
+    CompilationContext() = default;
+    CompilationContext(const CompilationContext &) = delete;
+    CompilationContext &operator=(const CompilationContext &) = delete;
+
+    SymbolTable &GetSymbolTable();
+    const SymbolTable &GetSymbolTable() const;
+
+    size_t NewLabel();
+
+    void AddDiagnostic(const std::string &message);
+    const std::vector<std::string> &GetDiagnostics() const;
+
+    // Named counters reported by --stats; adding to an existing name accumulates.
+    void AddStatistic(const std::string &name, size_t value);
+    const std::vector<std::pair<std::string, size_t>> &GetStatistics() const;
+
+private:
+    SymbolTable symbol_table_;
+    size_t label_id_ = 1;
+    std::vector<std::string> diagnostics_;
+    std::vector<std::pair<std::string, size_t>> statistics_;
+};
+}  // namespace my_cpp
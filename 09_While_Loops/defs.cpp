@@ -8,7 +8,7 @@
 namespace my_cpp {
 
 Token::Token(Type type, const std::string &text, std::unique_ptr<Value> value)
-    : type_(type), text_(text), value_(std::move(value)) {
+    : type_(type), value_(std::move(value)), text_(text) {
 }
 
 Token::Type Token::GetType() const {
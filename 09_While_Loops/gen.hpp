@@ -1,60 +1,88 @@
 #pragma once
 
 #include "ast.hpp"
+#include "context.hpp"
+#include "peval.hpp"
 // Standard includes
 // C++ Standard
 #include <optional>
 #include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 // C Standard
 
 namespace my_cpp {
-class CodeGenerator {
+// Tree traversal shared by every backend. The backend is the template parameter, so the hooks
+// codegen_ast calls (codegen_*, registers_*) are bound at compile time and can be inlined into
+// it. A backend derives from BasicCodeGenerator<Backend>, befriends it and hides the hooks it
+// implements; the defaults here throw. The member definitions live in gen_impl.hpp, which the
+// backend's translation unit includes to instantiate the traversal next to its hooks.
+template <typename Backend>
+class BasicCodeGenerator {
 public:
-    CodeGenerator(std::ostream &os);
-    virtual ~CodeGenerator() = default;
-    void GenerateCode(const std::shared_ptr<ASTNode> &stmts);
+    BasicCodeGenerator(CompilationContext &context, std::ostream &os);
+    void GenerateCode(const ASTNode &root);
+    // A program that prints what the evaluated prefix printed, sets every variable to the value
+    // it had then, and continues with the residual statements.
+    void GenerateResidual(const PartialEvaluation &evaluation);
 
 protected:
-    virtual void codegen_preemble() {
+    static constexpr size_t kNoRegister = static_cast<size_t>(-1);
+
+    ~BasicCodeGenerator() = default;
+
+    void codegen_preemble() {
     }
-    virtual void codegen_printint(size_t reg) {
+    void codegen_printint(size_t reg) {
         throw std::runtime_error("Not implemented");
     };
-    virtual void codegen_postemble() {
+    void codegen_postemble() {
     }
+    void codegen_text(std::string_view text) {
+        throw std::runtime_error("Not implemented");
+    };
 
-    virtual size_t codegen_add(size_t left_reg, size_t right_reg) {
+    size_t codegen_add(size_t left_reg, size_t right_reg) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_sub(size_t left_reg, size_t right_reg) {
+    size_t codegen_sub(size_t left_reg, size_t right_reg) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_mul(size_t left_reg, size_t right_reg) {
+    size_t codegen_mul(size_t left_reg, size_t right_reg) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_div(size_t left_reg, size_t right_reg) {
+    size_t codegen_div(size_t left_reg, size_t right_reg) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_load_int(size_t value) {
+    size_t codegen_load_int(int64_t value) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_load_gblob(const std::string &identifier) {
+    // Globals are passed by the symbol id the parser resolved.
+    size_t codegen_load_gblob(size_t id) {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t codegen_store_gblob(size_t reg, const std::string &identifier) {
+    size_t codegen_store_gblob(size_t reg, size_t id) {
+        throw std::runtime_error("Not implemented");
+    };
+    size_t codegen_load_local(size_t frame_offset) {
+        throw std::runtime_error("Not implemented");
+    };
+    size_t codegen_store_local(size_t reg, size_t frame_offset) {
         throw std::runtime_error("Not implemented");
     };
 
-    virtual void codegen_label(size_t label) {
+    void codegen_label(size_t label) {
         throw std::runtime_error("Not implemented");
     };
 
-    virtual void codegen_jump(size_t label) {
+    void codegen_jump(size_t label) {
         throw std::runtime_error("Not implemented");
     };
 
-    virtual size_t codegen_compare_and_jump(
+    size_t codegen_compare_and_jump(
             ASTNode::Type op,
             size_t left_reg,
             size_t right_reg,
@@ -62,39 +90,52 @@ protected:
         throw std::runtime_error("Not implemented");
     };
 
-    virtual size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg) {
+    size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg) {
         throw std::runtime_error("Not implemented");
     };
 
-    virtual void codegen_symbol(const std::string &identifier) {
+    void codegen_symbol(size_t id) {
         throw std::runtime_error("Not implemented");
     };
 
-    virtual void registers_free_all() {
+    void registers_free_all() {
         throw std::runtime_error("Not implemented");
     };
-    virtual size_t registers_alloc() {
+    size_t registers_alloc() {
         throw std::runtime_error("Not implemented");
     };
-    virtual void register_free(size_t reg) {
+    void register_free(size_t reg) {
         throw std::runtime_error("Not implemented");
     };
 
+    CompilationContext &context_;
     std::ostream &os_;
 
-protected:
-    const size_t kNoRegister = -1;
-    size_t label_id = 1;
-
 private:
+    // Ershov numbers of the binary expression nodes: how many registers each needs when its
+    // hungrier operand is evaluated first. Leaves need one and are not stored.
+    std::unordered_map<const ASTNode *, size_t> register_need_;
+
+    Backend &backend() {
+        return static_cast<Backend &>(*this);
+    }
+    // Sets used[id] for every variable the subtree declares, reads or assigns.
+    void mark_used(const ASTNode &node, std::vector<bool> &used) const;
+    size_t label_registers(const ASTNode &node);
+    size_t register_need(const ASTNode &node) const;
     size_t codegen_if(const ASTNode &if_stmt);
     size_t codegen_while(const ASTNode &while_stmt);
+    static ASTNode::Type negated(ASTNode::Type op);
+    std::pair<size_t, size_t> codegen_operands(const ASTNode &node);
     size_t codegen_ast(
             const ASTNode &node,
             std::optional<size_t> reg = std::nullopt,
             const ASTNode::Type parent_op = ASTNode::Type::A_NULL);
+    const SymbolTableEntry &symbol(const ASTNode &node) const {
+        return context_.GetSymbolTable().Get(node.GetValue<size_t>());
+    }
     size_t label_new() {
-        return label_id++;
+        return context_.NewLabel();
     }
 };
 }  // namespace my_cpp
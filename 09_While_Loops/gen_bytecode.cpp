@@ -0,0 +1,242 @@
+#include "gen_bytecode.hpp"
+
+#include "gen_impl.hpp"
+// Standard includes
+// C++ Standard
+#include <array>
+#include <limits>
+#include <stdexcept>
+// C Standard
+
+namespace my_cpp {
+namespace {
+constexpr std::array<const char *, 22> kOpcodeNames = {
+        "loadi", "load", "store", "add",  "sub",  "mul",  "div",  "eq",  "ne",    "lt",   "gt",
+        "le",    "ge",   "jeq",   "jne",  "jlt",  "jgt",  "jle",  "jge", "jump", "print", "halt",
+};
+
+Opcode opcode_offset(Opcode base, ASTNode::Type op) {
+    return static_cast<Opcode>(
+            static_cast<size_t>(base) + static_cast<size_t>(op)
+            - static_cast<size_t>(ASTNode::Type::A_EQ));
+}
+}  // namespace
+
+CodeGeneratorBytecode::CodeGeneratorBytecode(CompilationContext &context, std::ostream &os)
+    : BasicCodeGenerator(context, os) {
+}
+
+const Bytecode &CodeGeneratorBytecode::GetBytecode() const {
+    return bytecode_;
+}
+
+size_t CodeGeneratorBytecode::registers_alloc() {
+    for (size_t i = 0; i < registers_.size(); ++i) {
+        if (!registers_[i]) {
+            registers_[i] = true;
+            return i;
+        }
+    }
+    if (registers_.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::runtime_error("No free registers");
+    }
+    registers_.push_back(true);
+    bytecode_.num_registers = registers_.size();
+    return registers_.size() - 1;
+}
+
+void CodeGeneratorBytecode::register_free(size_t reg) {
+    if (registers_[reg] != true) {
+        throw std::runtime_error("Register is not allocated");
+    }
+    registers_[reg] = false;
+}
+
+void CodeGeneratorBytecode::registers_free_all() {
+    for (size_t i = 0; i < registers_.size(); ++i) {
+        registers_[i] = false;
+    }
+}
+
+void CodeGeneratorBytecode::codegen_preemble() {
+    registers_free_all();
+    bytecode_.num_slots = context_.GetSymbolTable().GetSlotCount();
+}
+
+void CodeGeneratorBytecode::codegen_postemble() {
+    emit(Opcode::kHalt, 0);
+    for (const auto &[pc, label] : fixups_) {
+        if (label >= label_pcs_.size() || label_pcs_[label] == kNoLabel) {
+            throw std::runtime_error("Undefined label");
+        }
+        bytecode_.code[pc].c = static_cast<int32_t>(label_pcs_[label]);
+    }
+    if (os_) {
+        os_ << bytecode_;
+    }
+}
+
+size_t CodeGeneratorBytecode::codegen_add(size_t left_reg, size_t right_reg) {
+    return binary(Opcode::kAdd, left_reg, right_reg);
+}
+
+size_t CodeGeneratorBytecode::codegen_sub(size_t left_reg, size_t right_reg) {
+    return binary(Opcode::kSub, left_reg, right_reg);
+}
+
+size_t CodeGeneratorBytecode::codegen_mul(size_t left_reg, size_t right_reg) {
+    return binary(Opcode::kMul, left_reg, right_reg);
+}
+
+size_t CodeGeneratorBytecode::codegen_div(size_t left_reg, size_t right_reg) {
+    return binary(Opcode::kDiv, left_reg, right_reg);
+}
+
+size_t CodeGeneratorBytecode::codegen_load_int(int64_t value) {
+    if (value < std::numeric_limits<int32_t>::min()
+        || value > std::numeric_limits<int32_t>::max()) {
+        throw std::runtime_error("Constant does not fit an instruction");
+    }
+    size_t reg = registers_alloc();
+    emit(Opcode::kLoadInt, reg, static_cast<int32_t>(value));
+    return reg;
+}
+
+size_t CodeGeneratorBytecode::codegen_load_gblob(size_t id) {
+    size_t reg = registers_alloc();
+    emit(Opcode::kLoad, reg, global_slot(id));
+    return reg;
+}
+
+size_t CodeGeneratorBytecode::codegen_store_gblob(size_t reg, size_t id) {
+    emit(Opcode::kStore, reg, global_slot(id));
+    register_free(reg);
+    return reg;
+}
+
+size_t CodeGeneratorBytecode::codegen_load_local(size_t frame_offset) {
+    size_t reg = registers_alloc();
+    emit(Opcode::kLoad, reg, local_slot(frame_offset));
+    return reg;
+}
+
+size_t CodeGeneratorBytecode::codegen_store_local(size_t reg, size_t frame_offset) {
+    emit(Opcode::kStore, reg, local_slot(frame_offset));
+    register_free(reg);
+    return reg;
+}
+
+void CodeGeneratorBytecode::codegen_label(size_t label) {
+    if (label >= label_pcs_.size()) {
+        label_pcs_.resize(label + 1, kNoLabel);
+    }
+    label_pcs_[label] = bytecode_.code.size();
+}
+
+void CodeGeneratorBytecode::codegen_jump(size_t label) {
+    fixups_.emplace_back(bytecode_.code.size(), label);
+    emit(Opcode::kJump, 0);
+}
+
+size_t CodeGeneratorBytecode::codegen_compare_and_jump(
+        ASTNode::Type op,
+        size_t left_reg,
+        size_t right_reg,
+        size_t jump_reg) {
+    // Jump when the comparison is false, i.e. on the inverse condition.
+    constexpr std::array<Opcode, 6> kInverse = {
+            Opcode::kJumpNe,
+            Opcode::kJumpEq,
+            Opcode::kJumpGe,
+            Opcode::kJumpLe,
+            Opcode::kJumpGt,
+            Opcode::kJumpLt};
+    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
+        throw std::runtime_error("Invalid operation");
+    }
+    fixups_.emplace_back(bytecode_.code.size(), jump_reg);
+    emit(
+            kInverse[static_cast<size_t>(op) - static_cast<size_t>(ASTNode::Type::A_EQ)],
+            left_reg,
+            right_reg);
+    registers_free_all();
+    return kNoRegister;
+}
+
+size_t CodeGeneratorBytecode::codegen_compare_and_set(
+        ASTNode::Type op,
+        size_t left_reg,
+        size_t right_reg) {
+    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
+        throw std::runtime_error("Invalid operation");
+    }
+    return binary(opcode_offset(Opcode::kEq, op), left_reg, right_reg);
+}
+
+void CodeGeneratorBytecode::codegen_symbol(size_t) {
+    // Every symbol already owns a slot.
+}
+
+void CodeGeneratorBytecode::codegen_printint(size_t reg) {
+    emit(Opcode::kPrint, reg);
+    register_free(reg);
+}
+
+void CodeGeneratorBytecode::emit(Opcode op, size_t a, int64_t b, int64_t c) {
+    bytecode_.code.push_back(
+            Instruction{op, static_cast<uint16_t>(a), static_cast<int32_t>(b),
+                        static_cast<int32_t>(c)});
+}
+
+size_t CodeGeneratorBytecode::binary(Opcode op, size_t left_reg, size_t right_reg) {
+    emit(op, left_reg, left_reg, right_reg);
+    register_free(right_reg);
+    return left_reg;
+}
+
+size_t CodeGeneratorBytecode::global_slot(size_t id) const {
+    return context_.GetSymbolTable().GetSlot(id);
+}
+
+size_t CodeGeneratorBytecode::local_slot(size_t frame_offset) const {
+    return context_.GetSymbolTable().GetLocalSlot(frame_offset);
+}
+
+template class BasicCodeGenerator<CodeGeneratorBytecode>;
+}  // namespace my_cpp
+
+std::ostream &operator<<(std::ostream &os, const my_cpp::Bytecode &bytecode) {
+    using my_cpp::Opcode;
+    for (size_t pc = 0; pc < bytecode.code.size(); ++pc) {
+        const auto &in = bytecode.code[pc];
+        os << pc << ":\t" << my_cpp::kOpcodeNames[static_cast<size_t>(in.op)];
+        switch (in.op) {
+        case Opcode::kLoadInt:
+            os << "\tr" << in.a << ", $" << in.b;
+            break;
+        case Opcode::kLoad:
+            os << "\tr" << in.a << ", [" << in.b << "]";
+            break;
+        case Opcode::kStore:
+            os << "\t[" << in.b << "], r" << in.a;
+            break;
+        case Opcode::kJump:
+            os << "\t" << in.c;
+            break;
+        case Opcode::kPrint:
+            os << "\tr" << in.a;
+            break;
+        case Opcode::kHalt:
+            break;
+        default:
+            if (in.op >= Opcode::kJumpEq) {
+                os << "\tr" << in.a << ", r" << in.b << ", " << in.c;
+            } else {
+                os << "\tr" << in.a << ", r" << in.b << ", r" << in.c;
+            }
+            break;
+        }
+        os << "\n";
+    }
+    return os;
+}
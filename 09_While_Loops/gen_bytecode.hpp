@@ -0,0 +1,69 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "gen.hpp"
+// Standard includes
+// C++ Standard
+#include <string_view>
+#include <utility>
+#include <vector>
+// C Standard
+
+namespace my_cpp {
+// Shares BasicCodeGenerator's traversal but emits Bytecode instead of assembly text. A listing of
+// the finished program is written to `os` unless the stream is not writable.
+class CodeGeneratorBytecode : public BasicCodeGenerator<CodeGeneratorBytecode> {
+public:
+    CodeGeneratorBytecode(CompilationContext &context, std::ostream &os);
+    ~CodeGeneratorBytecode() = default;
+    const Bytecode &GetBytecode() const;
+
+private:
+    friend class BasicCodeGenerator<CodeGeneratorBytecode>;
+
+    static constexpr size_t kNoLabel = static_cast<size_t>(-1);
+
+    Bytecode bytecode_;
+    std::vector<bool> registers_;
+    std::vector<size_t> label_pcs_;
+    // (instruction index, label) pairs to patch once every label is placed.
+    std::vector<std::pair<size_t, size_t>> fixups_;
+
+    size_t registers_alloc();
+    void register_free(size_t reg);
+    void registers_free_all();
+
+    void codegen_preemble();
+    void codegen_postemble();
+
+    size_t codegen_add(size_t left_reg, size_t right_reg);
+    size_t codegen_sub(size_t left_reg, size_t right_reg);
+    size_t codegen_mul(size_t left_reg, size_t right_reg);
+    size_t codegen_div(size_t left_reg, size_t right_reg);
+    size_t codegen_load_int(int64_t value);
+    size_t codegen_load_gblob(size_t id);
+    size_t codegen_store_gblob(size_t reg, size_t id);
+    size_t codegen_load_local(size_t frame_offset);
+    size_t codegen_store_local(size_t reg, size_t frame_offset);
+    void codegen_label(size_t label);
+    void codegen_jump(size_t label);
+
+    size_t codegen_compare_and_jump(
+            ASTNode::Type op,
+            size_t left_reg,
+            size_t right_reg,
+            size_t jump_reg);
+    size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg);
+
+    void codegen_symbol(size_t id);
+
+    void codegen_printint(size_t reg);
+
+    void emit(Opcode op, size_t a, int64_t b = 0, int64_t c = 0);
+    size_t binary(Opcode op, size_t left_reg, size_t right_reg);
+    size_t global_slot(size_t id) const;
+    size_t local_slot(size_t frame_offset) const;
+};
+
+extern template class BasicCodeGenerator<CodeGeneratorBytecode>;
+}  // namespace my_cpp
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "gen.hpp"
+// Standard includes
+// C++ Standard
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+// C Standard
+
+// Member definitions of BasicCodeGenerator. Only a backend's own translation unit includes this,
+// next to its hooks, and explicitly instantiates the traversal there.
+namespace my_cpp {
+template <typename Backend>
+BasicCodeGenerator<Backend>::BasicCodeGenerator(CompilationContext &context, std::ostream &os)
+    : context_(context), os_(os) {
+}
+
+template <typename Backend>
+void BasicCodeGenerator<Backend>::GenerateCode(const ASTNode &root) {
+    label_registers(root);
+    backend().codegen_preemble();
+    codegen_ast(root);
+    backend().registers_free_all();
+
+    backend().codegen_postemble();
+}
+
+template <typename Backend>
+void BasicCodeGenerator<Backend>::GenerateResidual(const PartialEvaluation &evaluation) {
+    for (const ASTNode *stmt : evaluation.residual) {
+        label_registers(*stmt);
+    }
+    backend().codegen_preemble();
+    if (!evaluation.output.empty()) {
+        backend().codegen_text(evaluation.output);
+    }
+    if (!evaluation.residual.empty()) {
+        const auto &symbols = context_.GetSymbolTable();
+        // Only the variables the residual statements use get storage and their value. Globals
+        // those statements declare are emitted when they are generated.
+        std::vector<bool> used(symbols.Size(), false), declared_later(symbols.Size(), false);
+        for (const ASTNode *stmt : evaluation.residual) {
+            mark_used(*stmt, used);
+            if (stmt->GetOp() == ASTNode::Type::A_VAR_DECL && !symbol(*stmt).IsLocal()) {
+                declared_later[stmt->GetValue<size_t>()] = true;
+            }
+        }
+        std::vector<bool> used_offsets(symbols.GetFrameSize() / SymbolTable::kSlotSize + 1, false);
+        for (size_t id = 0; id < symbols.Size(); ++id) {
+            const auto &entry = symbols.Get(id);
+            if (!used[id]) {
+                continue;
+            }
+            if (entry.IsLocal()) {
+                used_offsets[entry.GetFrameOffset() / SymbolTable::kSlotSize] = true;
+                continue;
+            }
+            if (declared_later[id]) {
+                continue;
+            }
+            backend().codegen_symbol(id);
+            if (const int64_t kValue = evaluation.slots[symbols.GetSlot(id)]; kValue != 0) {
+                const size_t kReg = backend().codegen_load_int(kValue);
+                backend().codegen_store_gblob(kReg, id);
+            }
+        }
+        for (size_t offset = SymbolTable::kSlotSize; offset <= symbols.GetFrameSize();
+             offset += SymbolTable::kSlotSize) {
+            const int64_t kValue = evaluation.slots[symbols.GetLocalSlot(offset)];
+            if (used_offsets[offset / SymbolTable::kSlotSize] && kValue != 0) {
+                backend().codegen_store_local(backend().codegen_load_int(kValue), offset);
+            }
+        }
+        for (const ASTNode *stmt : evaluation.residual) {
+            codegen_ast(*stmt);
+            backend().registers_free_all();
+        }
+    }
+    backend().codegen_postemble();
+}
+
+template <typename Backend>
+void BasicCodeGenerator<Backend>::mark_used(const ASTNode &node, std::vector<bool> &used) const {
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_IDENT:
+    case ASTNode::Type::A_LVIDENT:
+    case ASTNode::Type::A_VAR_DECL:
+        used[node.GetValue<size_t>()] = true;
+        break;
+    default:
+        break;
+    }
+    if (node.GetLeft() != nullptr) {
+        mark_used(*node.GetLeft(), used);
+    }
+    if (node.GetMiddle() != nullptr) {
+        mark_used(*node.GetMiddle(), used);
+    }
+    if (node.GetRight() != nullptr) {
+        mark_used(*node.GetRight(), used);
+    }
+}
+
+template <typename Backend>
+size_t BasicCodeGenerator<Backend>::label_registers(const ASTNode &node) {
+    size_t left = 0, right = 0;
+    if (node.GetLeft() != nullptr) {
+        left = label_registers(*node.GetLeft());
+    }
+    if (node.GetMiddle() != nullptr) {
+        label_registers(*node.GetMiddle());
+    }
+    if (node.GetRight() != nullptr) {
+        right = label_registers(*node.GetRight());
+    }
+    if (!(ASTNode::Type::A_ADD <= node.GetOp() && node.GetOp() <= ASTNode::Type::A_GE)) {
+        return 1;
+    }
+    const size_t kNeed = left == right ? left + 1 : std::max(left, right);
+    register_need_[&node] = kNeed;
+    return kNeed;
+}
+
+template <typename Backend>
+size_t BasicCodeGenerator<Backend>::register_need(const ASTNode &node) const {
+    auto it = register_need_.find(&node);
+    return it != register_need_.end() ? it->second : 1;
+}
+
+template <typename Backend>
+size_t BasicCodeGenerator<Backend>::codegen_if(const ASTNode &if_stmt) {
+    size_t label_false = 0, label_end = 0;
+    label_false = label_new();
+
+    if (if_stmt.GetRight() != nullptr) {
+        label_end = label_new();
+    }
+
+    codegen_ast(*(if_stmt.GetLeft()), label_false, if_stmt.GetOp());
+    backend().registers_free_all();
+
+    // An empty block parses to no node at all.
+    if (if_stmt.GetMiddle() != nullptr) {
+        codegen_ast(*(if_stmt.GetMiddle()), std::nullopt, if_stmt.GetOp());
+    }
+
+    if (if_stmt.GetRight() != nullptr) {
+        backend().codegen_jump(label_end);
+    }
+
+    backend().codegen_label(label_false);
+    if (if_stmt.GetRight() != nullptr) {
+        codegen_ast(*(if_stmt.GetRight()), std::nullopt, if_stmt.GetOp());
+        backend().registers_free_all();
+        backend().codegen_label(label_end);
+    }
+    return kNoRegister;
+}
+
+// Rotated into a guard and a bottom-tested loop, so that an iteration takes one branch instead of
+// a conditional exit and a jump back:
+//   if (!cond) goto end; body: stmts; if (cond) goto body; end:
+// The condition is generated twice but still evaluated once per test, as before.
+template <typename Backend>
+size_t BasicCodeGenerator<Backend>::codegen_while(const ASTNode &while_stmt) {
+    size_t label_body, label_end;
+    label_body = label_new();
+    label_end = label_new();
+
+    codegen_ast(*(while_stmt.GetLeft()), label_end, while_stmt.GetOp());
+    backend().registers_free_all();
+
+    backend().codegen_label(label_body);
+    if (while_stmt.GetRight() != nullptr) {
+        codegen_ast(*(while_stmt.GetRight()), std::nullopt, while_stmt.GetOp());
+        backend().registers_free_all();
+    }
+
+    // The hook jumps when its comparison fails, so the back branch is given the opposite one.
+    const ASTNode &condition = *(while_stmt.GetLeft());
+    const auto [left_reg, right_reg] = codegen_operands(condition);
+    backend().codegen_compare_and_jump(negated(condition.GetOp()), left_reg, right_reg, label_body);
+    backend().registers_free_all();
+
+    backend().codegen_label(label_end);
+    return kNoRegister;
+}
+
+template <typename Backend>
+ASTNode::Type BasicCodeGenerator<Backend>::negated(ASTNode::Type op) {
+    switch (op) {
+    case ASTNode::Type::A_EQ:
+        return ASTNode::Type::A_NE;
+    case ASTNode::Type::A_NE:
+        return ASTNode::Type::A_EQ;
+    case ASTNode::Type::A_LT:
+        return ASTNode::Type::A_GE;
+    case ASTNode::Type::A_GT:
+        return ASTNode::Type::A_LE;
+    case ASTNode::Type::A_LE:
+        return ASTNode::Type::A_GT;
+    case ASTNode::Type::A_GE:
+        return ASTNode::Type::A_LT;
+    default:
+        throw std::runtime_error("Invalid comparison operator");
+    }
+}
+
+// The operand needing more registers goes first so that fewer values are live while the other
+// one is computed. The hooks take both registers by role, so the order is free.
+template <typename Backend>
+std::pair<size_t, size_t> BasicCodeGenerator<Backend>::codegen_operands(const ASTNode &node) {
+    size_t left_reg = kNoRegister, right_reg = kNoRegister;
+    if (node.GetLeft() != nullptr && node.GetRight() != nullptr
+        && register_need(*node.GetRight()) > register_need(*node.GetLeft())) {
+        right_reg = codegen_ast(*node.GetRight());
+        left_reg = codegen_ast(*node.GetLeft());
+    } else {
+        if (node.GetLeft() != nullptr) {
+            left_reg = codegen_ast(*node.GetLeft());
+        }
+        if (node.GetRight() != nullptr) {
+            right_reg = codegen_ast(*node.GetRight(), left_reg);
+        }
+    }
+    return {left_reg, right_reg};
+}
+
+template <typename Backend>
+size_t BasicCodeGenerator<Backend>::codegen_ast(
+        const ASTNode &node,
+        std::optional<size_t> reg,
+        const ASTNode::Type parent_op) {
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_IF:
+        return codegen_if(node);
+    case ASTNode::Type::A_WHILE:
+        return codegen_while(node);
+    case ASTNode::Type::A_GLUE:
+        if (node.GetLeft() != nullptr) {
+            codegen_ast(*node.GetLeft(), std::nullopt, parent_op);
+            backend().registers_free_all();
+        }
+        if (node.GetRight() != nullptr) {
+            codegen_ast(*node.GetRight(), std::nullopt, parent_op);
+            backend().registers_free_all();
+        }
+        return kNoRegister;
+    default:
+        break;
+    }
+
+    const auto [left_reg, right_reg] = codegen_operands(node);
+
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_ADD:
+        return backend().codegen_add(left_reg, right_reg);
+    case ASTNode::Type::A_SUBTRACT:
+        return backend().codegen_sub(left_reg, right_reg);
+    case ASTNode::Type::A_MULTIPLY:
+        return backend().codegen_mul(left_reg, right_reg);
+    case ASTNode::Type::A_DIVIDE:
+        return backend().codegen_div(left_reg, right_reg);
+    case ASTNode::Type::A_EQ:
+    case ASTNode::Type::A_NE:
+    case ASTNode::Type::A_LT:
+    case ASTNode::Type::A_GT:
+    case ASTNode::Type::A_LE:
+    case ASTNode::Type::A_GE: {
+        if (parent_op == ASTNode::Type::A_IF || parent_op == ASTNode::Type::A_WHILE) {
+            return backend().codegen_compare_and_jump(node.GetOp(), left_reg, right_reg, *reg);
+        } else {
+            return backend().codegen_compare_and_set(node.GetOp(), left_reg, right_reg);
+        }
+    }
+    case ASTNode::Type::A_INTLIT:
+        return backend().codegen_load_int(node.GetValue<int>());
+    case ASTNode::Type::A_LVIDENT: {
+        if (!reg.has_value()) {
+            throw std::runtime_error("Invalid register");
+        }
+        const auto &entry = symbol(node);
+        if (entry.IsLocal()) {
+            return backend().codegen_store_local(*reg, entry.GetFrameOffset());
+        }
+        return backend().codegen_store_gblob(*reg, node.GetValue<size_t>());
+    }
+    case ASTNode::Type::A_IDENT: {
+        const auto &entry = symbol(node);
+        if (entry.IsLocal()) {
+            return backend().codegen_load_local(entry.GetFrameOffset());
+        }
+        return backend().codegen_load_gblob(node.GetValue<size_t>());
+    }
+    case ASTNode::Type::A_ASSIGN:
+        return right_reg;
+    case ASTNode::Type::A_VAR_DECL: {
+        // Locals live in the frame sized by the preamble, where their slot may still hold what
+        // an earlier block or iteration left, so each declaration sets them to 0 like a global
+        // starts out. Only globals need storage emitted.
+        const auto &entry = symbol(node);
+        if (entry.IsLocal()) {
+            backend().codegen_store_local(backend().codegen_load_int(0), entry.GetFrameOffset());
+        } else {
+            backend().codegen_symbol(node.GetValue<size_t>());
+        }
+        return 0;
+    }
+    case ASTNode::Type::A_PRINT:
+        backend().codegen_printint(left_reg);
+        return 0;
+    default:
+        throw std::runtime_error("Invalid ASTNode type");
+    }
+}
+}  // namespace my_cpp
@@ -0,0 +1,404 @@
+#include "gen_jit.hpp"
+
+#include "arith.hpp"
+#include "gen_impl.hpp"
+// Standard includes
+// C++ Standard
+#include <array>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+// C Standard
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace my_cpp {
+namespace {
+// Called from generated code, so it must not throw.
+void print_callback(OutputBuffer *output, int64_t value) noexcept {
+    output->PrintInt(value);
+}
+
+size_t condition_index(ASTNode::Type op) {
+    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
+        throw std::runtime_error("Invalid operation");
+    }
+    return static_cast<size_t>(op) - static_cast<size_t>(ASTNode::Type::A_EQ);
+}
+}  // namespace
+
+ExecutableMemory::ExecutableMemory(const std::vector<uint8_t> &code) {
+    const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_ = (code.size() + kPageSize - 1) / kPageSize * kPageSize;
+    address_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address_ == MAP_FAILED) {
+        throw std::runtime_error("Cannot map memory for generated code");
+    }
+    std::memcpy(address_, code.data(), code.size());
+    if (mprotect(address_, size_, PROT_READ | PROT_EXEC) != 0) {
+        munmap(address_, size_);
+        throw std::runtime_error("Cannot make generated code executable");
+    }
+}
+
+ExecutableMemory::~ExecutableMemory() {
+    munmap(address_, size_);
+}
+
+const void *ExecutableMemory::GetAddress() const {
+    return address_;
+}
+
+CodeGeneratorJIT::CodeGeneratorJIT(
+        CompilationContext &context,
+        std::ostream &os,
+        OutputBuffer &output,
+        Linkage linkage)
+    : BasicCodeGenerator(context, os),
+      output_(output),
+      linkage_(linkage),
+      registers_(7, false),
+      // Same caller-saved registers as CodeGeneratorX86 uses before it needs to spill, which is
+      // already more than any expression of the language keeps live at once.
+      registers_map_{kR8, kR9, kR10, kR11, kRcx, kRsi, kRdi} {
+}
+
+void CodeGeneratorJIT::Run(int64_t *slots) {
+    if (memory_ == nullptr) {
+        throw std::runtime_error("No code generated");
+    }
+    if (linkage_ == Linkage::kFragment && slots == nullptr) {
+        throw std::runtime_error("Fragment needs a slot array");
+    }
+    auto entry =
+            reinterpret_cast<int (*)(int64_t *)>(const_cast<void *>(memory_->GetAddress()));
+    const int kStatus = entry(slots);
+    if (linkage_ == Linkage::kProgram) {
+        output_.Flush();
+    }
+    switch (kStatus) {
+    case kOk:
+        break;
+    case kDivisionByZero:
+        throw arith::Fault("Division by zero");
+    case kDivisionOverflow:
+        throw arith::Fault("Division overflow");
+    default:
+        throw std::runtime_error("Generated code failed");
+    }
+}
+
+size_t CodeGeneratorJIT::registers_alloc() {
+    for (size_t i = 0; i < registers_.size(); ++i) {
+        if (!registers_[i]) {
+            registers_[i] = true;
+            return i;
+        }
+    }
+    throw std::runtime_error("No free registers");
+}
+
+void CodeGeneratorJIT::register_free(size_t reg) {
+    if (registers_[reg] != true) {
+        throw std::runtime_error("Register is not allocated");
+    }
+    registers_[reg] = false;
+}
+
+void CodeGeneratorJIT::registers_free_all() {
+    for (size_t i = 0; i < registers_.size(); ++i) {
+        registers_[i] = false;
+    }
+}
+
+void CodeGeneratorJIT::codegen_preemble() {
+    registers_free_all();
+    label_epilogue_ = context_.NewLabel();
+    label_division_by_zero_ = context_.NewLabel();
+    label_division_overflow_ = context_.NewLabel();
+
+    // The callee-saved %rbx is kept below the locals; the frame stays 16-byte aligned for calls.
+    const size_t kLocals =
+            linkage_ == Linkage::kProgram ? context_.GetSymbolTable().GetFrameSize() : 0;
+    frame_size_ = (kLocals + 8 + 15) & ~size_t{15};
+    emit8(0x55);  // pushq %rbp
+    emit_alu(0x89, kRbp, kRsp);
+    emit_rex(true, 0, kRsp);  // subq $frame, %rsp
+    emit8(0x81);
+    emit_modrm(3, 5, kRsp);
+    emit32(static_cast<uint32_t>(frame_size_));
+    emit_mov_store(kRbp, -static_cast<int32_t>(frame_size_), kRbx);
+    if (linkage_ == Linkage::kProgram) {
+        data_.assign(context_.GetSymbolTable().Size(), 0);
+        emit_mov_imm(kRbx, reinterpret_cast<int64_t>(data_.data()));
+    } else {
+        emit_alu(0x89, kRbx, kRdi);  // movq %rdi, %rbx
+    }
+}
+
+void CodeGeneratorJIT::codegen_postemble() {
+    emit8(0xb8);  // movl $kOk, %eax
+    emit32(kOk);
+    codegen_label(label_epilogue_);
+    emit_mov_load(kRbx, kRbp, -static_cast<int32_t>(frame_size_));
+    emit8(0xc9);  // leave
+    emit8(0xc3);  // ret
+
+    codegen_label(label_division_by_zero_);
+    emit8(0xb8);
+    emit32(kDivisionByZero);
+    emit_jmp(label_epilogue_);
+    codegen_label(label_division_overflow_);
+    emit8(0xb8);
+    emit32(kDivisionOverflow);
+    emit_jmp(label_epilogue_);
+
+    for (const auto &[offset, label] : fixups_) {
+        if (label >= label_offsets_.size() || label_offsets_[label] == kNoLabel) {
+            throw std::runtime_error("Undefined label");
+        }
+        const int32_t kRel = static_cast<int32_t>(label_offsets_[label] - (offset + 4));
+        std::memcpy(&code_[offset], &kRel, sizeof(kRel));
+    }
+    memory_ = std::make_unique<ExecutableMemory>(code_);
+
+    if (os_) {
+        for (size_t i = 0; i < code_.size(); ++i) {
+            os_ << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(code_[i])
+                << ((i % 16 == 15 || i + 1 == code_.size()) ? "\n" : " ");
+        }
+        os_ << std::dec;
+    }
+}
+
+size_t CodeGeneratorJIT::codegen_add(size_t left_reg, size_t right_reg) {
+    emit_alu(0x01, registers_map_[right_reg], registers_map_[left_reg]);
+    register_free(left_reg);
+    return right_reg;
+}
+
+size_t CodeGeneratorJIT::codegen_sub(size_t left_reg, size_t right_reg) {
+    emit_alu(0x29, registers_map_[left_reg], registers_map_[right_reg]);
+    register_free(right_reg);
+    return left_reg;
+}
+
+size_t CodeGeneratorJIT::codegen_mul(size_t left_reg, size_t right_reg) {
+    // imulq left, right
+    emit_rex(true, registers_map_[right_reg], registers_map_[left_reg]);
+    emit8(0x0f);
+    emit8(0xaf);
+    emit_modrm(3, registers_map_[right_reg], registers_map_[left_reg]);
+    register_free(left_reg);
+    return right_reg;
+}
+
+size_t CodeGeneratorJIT::codegen_div(size_t left_reg, size_t right_reg) {
+    const uint8_t kLeft = registers_map_[left_reg];
+    const uint8_t kRight = registers_map_[right_reg];
+    const size_t kLabelDivide = context_.NewLabel();
+    // idivq would fault on these; leave main with a status instead.
+    emit_alu(0x85, kRight, kRight);  // testq right, right
+    emit_jcc(kE, label_division_by_zero_);
+    emit_rex(true, 0, kRight);  // cmpq $-1, right
+    emit8(0x83);
+    emit_modrm(3, 7, kRight);
+    emit8(0xff);
+    emit_jcc(kNe, kLabelDivide);
+    emit_mov_imm(kRax, std::numeric_limits<int64_t>::min());
+    emit_alu(0x39, kLeft, kRax);
+    emit_jcc(kE, label_division_overflow_);
+    codegen_label(kLabelDivide);
+
+    emit_alu(0x89, kRax, kLeft);  // movq left, %rax
+    emit8(0x48);                  // cqo
+    emit8(0x99);
+    emit_rex(true, 0, kRight);  // idivq right
+    emit8(0xf7);
+    emit_modrm(3, 7, kRight);
+    emit_alu(0x89, kRight, kRax);  // movq %rax, right
+    register_free(left_reg);
+    return right_reg;
+}
+
+size_t CodeGeneratorJIT::codegen_load_int(int64_t value) {
+    size_t reg = registers_alloc();
+    emit_mov_imm(registers_map_[reg], value);
+    return reg;
+}
+
+size_t CodeGeneratorJIT::codegen_load_gblob(size_t id) {
+    size_t reg = registers_alloc();
+    emit_mov_load(registers_map_[reg], kRbx, global_disp(id));
+    return reg;
+}
+
+size_t CodeGeneratorJIT::codegen_store_gblob(size_t reg, size_t id) {
+    emit_mov_store(kRbx, global_disp(id), registers_map_[reg]);
+    register_free(reg);
+    return reg;
+}
+
+size_t CodeGeneratorJIT::codegen_load_local(size_t frame_offset) {
+    size_t reg = registers_alloc();
+    if (linkage_ == Linkage::kProgram) {
+        emit_mov_load(registers_map_[reg], kRbp, -static_cast<int32_t>(frame_offset));
+    } else {
+        emit_mov_load(registers_map_[reg], kRbx, local_disp(frame_offset));
+    }
+    return reg;
+}
+
+size_t CodeGeneratorJIT::codegen_store_local(size_t reg, size_t frame_offset) {
+    if (linkage_ == Linkage::kProgram) {
+        emit_mov_store(kRbp, -static_cast<int32_t>(frame_offset), registers_map_[reg]);
+    } else {
+        emit_mov_store(kRbx, local_disp(frame_offset), registers_map_[reg]);
+    }
+    register_free(reg);
+    return reg;
+}
+
+void CodeGeneratorJIT::codegen_label(size_t label) {
+    if (label >= label_offsets_.size()) {
+        label_offsets_.resize(label + 1, kNoLabel);
+    }
+    label_offsets_[label] = code_.size();
+}
+
+void CodeGeneratorJIT::codegen_jump(size_t label) {
+    emit_jmp(label);
+}
+
+size_t CodeGeneratorJIT::codegen_compare_and_jump(
+        ASTNode::Type op,
+        size_t left_reg,
+        size_t right_reg,
+        size_t jump_reg) {
+    // Jump when the comparison is false.
+    constexpr std::array<Condition, 6> kInverse = {kNe, kE, kGe, kLe, kG, kL};
+    emit_alu(0x39, registers_map_[left_reg], registers_map_[right_reg]);
+    emit_jcc(kInverse[condition_index(op)], jump_reg);
+    registers_free_all();
+    return kNoRegister;
+}
+
+size_t CodeGeneratorJIT::codegen_compare_and_set(
+        ASTNode::Type op,
+        size_t left_reg,
+        size_t right_reg) {
+    constexpr std::array<Condition, 6> kConditions = {kE, kNe, kL, kG, kLe, kGe};
+    const uint8_t kRight = registers_map_[right_reg];
+    emit_alu(0x39, registers_map_[left_reg], kRight);
+    emit_rex(false, 0, kRight);  // setcc right8
+    emit8(0x0f);
+    emit8(0x90 | kConditions[condition_index(op)]);
+    emit_modrm(3, 0, kRight);
+    emit_rex(true, kRight, kRight);  // movzbq right8, right
+    emit8(0x0f);
+    emit8(0xb6);
+    emit_modrm(3, kRight, kRight);
+    register_free(left_reg);
+    return right_reg;
+}
+
+void CodeGeneratorJIT::codegen_symbol(size_t) {
+    // Every global already owns a slot in the data block.
+}
+
+void CodeGeneratorJIT::codegen_printint(size_t reg) {
+    emit_alu(0x89, kRsi, registers_map_[reg]);
+    emit_mov_imm(kRdi, reinterpret_cast<int64_t>(&output_));
+    emit_call(reinterpret_cast<const void *>(&print_callback));
+    register_free(reg);
+}
+
+void CodeGeneratorJIT::emit8(uint8_t byte) {
+    code_.push_back(byte);
+}
+
+void CodeGeneratorJIT::emit32(uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) {
+        emit8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void CodeGeneratorJIT::emit64(uint64_t value) {
+    emit32(static_cast<uint32_t>(value));
+    emit32(static_cast<uint32_t>(value >> 32));
+}
+
+void CodeGeneratorJIT::emit_rex(bool wide, uint8_t reg, uint8_t rm) {
+    // Always emitted for byte registers so that 4-7 mean %spl..%dil rather than %ah..%bh.
+    emit8(0x40 | (wide ? 0x08 : 0) | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+void CodeGeneratorJIT::emit_modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+    emit8(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+}
+
+void CodeGeneratorJIT::emit_mov_imm(uint8_t reg, int64_t value) {
+    if (std::numeric_limits<int32_t>::min() <= value
+        && value <= std::numeric_limits<int32_t>::max()) {
+        emit_rex(true, 0, reg);  // movq $imm32, reg (sign-extended)
+        emit8(0xc7);
+        emit_modrm(3, 0, reg);
+        emit32(static_cast<uint32_t>(value));
+    } else {
+        emit_rex(true, 0, reg);  // movabsq $imm64, reg
+        emit8(0xb8 | (reg & 7));
+        emit64(static_cast<uint64_t>(value));
+    }
+}
+
+void CodeGeneratorJIT::emit_mov_load(uint8_t reg, uint8_t base, int32_t disp) {
+    emit_rex(true, reg, base);
+    emit8(0x8b);
+    emit_modrm(2, reg, base);
+    emit32(static_cast<uint32_t>(disp));
+}
+
+void CodeGeneratorJIT::emit_mov_store(uint8_t base, int32_t disp, uint8_t reg) {
+    emit_rex(true, reg, base);
+    emit8(0x89);
+    emit_modrm(2, reg, base);
+    emit32(static_cast<uint32_t>(disp));
+}
+
+void CodeGeneratorJIT::emit_alu(uint8_t opcode, uint8_t rm, uint8_t reg) {
+    emit_rex(true, reg, rm);
+    emit8(opcode);
+    emit_modrm(3, reg, rm);
+}
+
+void CodeGeneratorJIT::emit_jcc(Condition cc, size_t label) {
+    emit8(0x0f);
+    emit8(0x80 | cc);
+    fixups_.emplace_back(code_.size(), label);
+    emit32(0);
+}
+
+void CodeGeneratorJIT::emit_jmp(size_t label) {
+    emit8(0xe9);
+    fixups_.emplace_back(code_.size(), label);
+    emit32(0);
+}
+
+void CodeGeneratorJIT::emit_call(const void *function) {
+    emit_mov_imm(kRax, reinterpret_cast<int64_t>(function));
+    emit8(0xff);  // call *%rax
+    emit_modrm(3, 2, kRax);
+}
+
+int32_t CodeGeneratorJIT::global_disp(size_t id) const {
+    return static_cast<int32_t>(context_.GetSymbolTable().GetSlot(id) * sizeof(int64_t));
+}
+
+int32_t CodeGeneratorJIT::local_disp(size_t frame_offset) const {
+    return static_cast<int32_t>(
+            context_.GetSymbolTable().GetLocalSlot(frame_offset) * sizeof(int64_t));
+}
+
+template class BasicCodeGenerator<CodeGeneratorJIT>;
+}  // namespace my_cpp
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "gen.hpp"
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Page-granular mapping that is writable while code is copied in and executable afterwards,
+// never both at once.
+class ExecutableMemory {
+public:
+    ExecutableMemory(const std::vector<uint8_t> &code);
+    ~ExecutableMemory();
+    ExecutableMemory(const ExecutableMemory &) = delete;
+    ExecutableMemory &operator=(const ExecutableMemory &) = delete;
+    const void *GetAddress() const;
+
+private:
+    void *address_;
+    size_t size_;
+};
+
+// Encodes the instructions CodeGeneratorX86 prints (mov/add/sub/imul/idiv/cmp/setcc/jcc/jmp/call)
+// straight into machine code and runs it in-process. Variables are addressed through %rbx: for a
+// whole program it points at a data block holding the globals while locals stay at %rbp offsets;
+// for a fragment (any statement, typically one hot loop) it points at the caller's slot array,
+// laid out by SymbolTable::GetSlot(), which holds every variable. Jumps are back-patched once
+// every label is placed. A hex dump of the code is written to `os` unless it is not writable.
+class CodeGeneratorJIT : public BasicCodeGenerator<CodeGeneratorJIT> {
+public:
+    enum class Linkage {
+        kProgram,
+        kFragment,
+    };
+
+    CodeGeneratorJIT(
+            CompilationContext &context,
+            std::ostream &os,
+            OutputBuffer &output,
+            Linkage linkage = Linkage::kProgram);
+    ~CodeGeneratorJIT() = default;
+    // `slots` is only used, and required, by fragments.
+    void Run(int64_t *slots = nullptr);
+
+private:
+    friend class BasicCodeGenerator<CodeGeneratorJIT>;
+
+    // Machine register numbers.
+    enum Register : uint8_t {
+        kRax = 0,
+        kRcx = 1,
+        kRdx = 2,
+        kRbx = 3,
+        kRsp = 4,
+        kRbp = 5,
+        kRsi = 6,
+        kRdi = 7,
+        kR8 = 8,
+        kR9 = 9,
+        kR10 = 10,
+        kR11 = 11,
+    };
+    // Condition codes, as used by jcc/setcc.
+    enum Condition : uint8_t {
+        kE = 0x4,
+        kNe = 0x5,
+        kL = 0xc,
+        kGe = 0xd,
+        kLe = 0xe,
+        kG = 0xf,
+    };
+    // Value main returns in %eax.
+    enum Status : int {
+        kOk = 0,
+        kDivisionByZero = 1,
+        kDivisionOverflow = 2,
+    };
+
+    static constexpr size_t kNoLabel = static_cast<size_t>(-1);
+
+    OutputBuffer &output_;
+    const Linkage linkage_;
+    std::vector<int64_t> data_;
+    std::vector<uint8_t> code_;
+    std::unique_ptr<ExecutableMemory> memory_;
+
+    std::vector<bool> registers_;
+    const std::vector<Register> registers_map_;
+    size_t frame_size_ = 0;
+    std::vector<size_t> label_offsets_;
+    // (offset of a rel32 field, label) pairs to patch once every label is placed.
+    std::vector<std::pair<size_t, size_t>> fixups_;
+    size_t label_epilogue_ = 0;
+    size_t label_division_by_zero_ = 0;
+    size_t label_division_overflow_ = 0;
+
+    size_t registers_alloc();
+    void register_free(size_t reg);
+    void registers_free_all();
+
+    void codegen_preemble();
+    void codegen_postemble();
+
+    size_t codegen_add(size_t left_reg, size_t right_reg);
+    size_t codegen_sub(size_t left_reg, size_t right_reg);
+    size_t codegen_mul(size_t left_reg, size_t right_reg);
+    size_t codegen_div(size_t left_reg, size_t right_reg);
+    size_t codegen_load_int(int64_t value);
+    size_t codegen_load_gblob(size_t id);
+    size_t codegen_store_gblob(size_t reg, size_t id);
+    size_t codegen_load_local(size_t frame_offset);
+    size_t codegen_store_local(size_t reg, size_t frame_offset);
+    void codegen_label(size_t label);
+    void codegen_jump(size_t label);
+
+    size_t codegen_compare_and_jump(
+            ASTNode::Type op,
+            size_t left_reg,
+            size_t right_reg,
+            size_t jump_reg);
+    size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg);
+
+    void codegen_symbol(size_t id);
+
+    void codegen_printint(size_t reg);
+
+    // Encoders
+    void emit8(uint8_t byte);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+    void emit_rex(bool wide, uint8_t reg, uint8_t rm);
+    void emit_modrm(uint8_t mod, uint8_t reg, uint8_t rm);
+    void emit_mov_imm(uint8_t reg, int64_t value);
+    void emit_mov_load(uint8_t reg, uint8_t base, int32_t disp);
+    void emit_mov_store(uint8_t base, int32_t disp, uint8_t reg);
+    // <opcode> rm, reg for the 0x01/0x29/0x39/0x85/0x89 family.
+    void emit_alu(uint8_t opcode, uint8_t rm, uint8_t reg);
+    void emit_jcc(Condition cc, size_t label);
+    void emit_jmp(size_t label);
+    void emit_call(const void *function);
+
+    int32_t global_disp(size_t id) const;
+    int32_t local_disp(size_t frame_offset) const;
+};
+
+extern template class BasicCodeGenerator<CodeGeneratorJIT>;
+}  // namespace my_cpp
@@ -1,182 +1,782 @@
 #include "gen_x86.hpp"
+
+#include "ifconvert.hpp"
+#include "ir_builder.hpp"
+#include "peephole.hpp"
+#include "promote.hpp"
+#include "ssa.hpp"
 // Standard includes
 // C++ Standard
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
 // C Standard
+#include <cstdint>
 
 namespace my_cpp {
-CodeGeneratorX86::CodeGeneratorX86(std::ostream &os)
-    : CodeGenerator(os),
-      registers_(4, false),
-      registers_names_{"%r8", "%r9", "%r10", "%r11"},
-      bregisters_names_{"%r8b", "%r9b", "%r10b", "%r11b"} {
+namespace {
+Operand immediate(int64_t value) {
+    Operand operand;
+    operand.kind = Operand::Kind::kImmediate;
+    operand.value = value;
+    return operand;
+}
+
+// value(base) or, with an index, value(base,index,scale).
+Operand memory(
+        int64_t value,
+        std::string_view base,
+        std::string_view index = {},
+        uint8_t scale = 1) {
+    Operand operand;
+    operand.kind = Operand::Kind::kMemory;
+    operand.value = value;
+    operand.name = base;
+    operand.index = index;
+    operand.scale = scale;
+    return operand;
+}
+
+Operand frame_address(size_t offset) {
+    return memory(-static_cast<int64_t>(offset), "%rbp");
+}
+
+Operand symbol(std::string_view name) {
+    Operand operand;
+    operand.kind = Operand::Kind::kLabel;
+    operand.name = name;
+    return operand;
+}
+
+Operand label_name(std::string_view prefix, int64_t label) {
+    Operand operand = symbol(prefix);
+    operand.numbered = true;
+    operand.value = label;
+    return operand;
+}
+
+Operand rip_address(Operand label) {
+    label.kind = Operand::Kind::kRipRelative;
+    return label;
+}
+
+// The multiplier and shift with which the high half of n * multiplier, shifted right by `shift`
+// and rounded toward zero, is n / divisor for every 64-bit n (Granlund and Montgomery, in the
+// form of Hacker's Delight 10-1). Needs |divisor| >= 2 and not a power of two.
+struct Magic {
+    int64_t multiplier;
+    int shift;
+};
+
+Magic signed_magic(int64_t divisor) {
+    constexpr uint64_t kTwo63 = uint64_t{1} << 63;
+    const uint64_t kAbs = divisor < 0 ? 0 - static_cast<uint64_t>(divisor)
+                                      : static_cast<uint64_t>(divisor);
+    const uint64_t kLimit = kTwo63 + (static_cast<uint64_t>(divisor) >> 63);
+    const uint64_t kAbsNc = kLimit - 1 - kLimit % kAbs;
+    int p = 63;
+    uint64_t q1 = kTwo63 / kAbsNc, r1 = kTwo63 - q1 * kAbsNc;
+    uint64_t q2 = kTwo63 / kAbs, r2 = kTwo63 - q2 * kAbs;
+    uint64_t delta = 0;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= kAbsNc) {
+            ++q1;
+            r1 -= kAbsNc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= kAbs) {
+            ++q2;
+            r2 -= kAbs;
+        }
+        delta = kAbs - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    const uint64_t kMultiplier = divisor < 0 ? 0 - (q2 + 1) : q2 + 1;
+    return {static_cast<int64_t>(kMultiplier), p - 64};
+}
+}  // namespace
+
+CodeGeneratorX86::CodeGeneratorX86(
+        CompilationContext &context,
+        std::ostream &os,
+        bool optimize,
+        std::ostream *ir_dump)
+    : context_(context),
+      os_(os),
+      optimize_(optimize),
+      ir_dump_(ir_dump),
+      out_(os) {
+}
+
+void CodeGeneratorX86::GenerateCode(const ASTNode &root) {
+    IRBuilder builder(context_, os_);
+    builder.GenerateCode(root);
+    emit_function(builder.TakeFunction());
+}
+
+void CodeGeneratorX86::GenerateResidual(const PartialEvaluation &evaluation) {
+    IRBuilder builder(context_, os_);
+    builder.GenerateResidual(evaluation);
+    emit_function(builder.TakeFunction());
 }
 
-size_t CodeGeneratorX86::registers_alloc() {
-    for (size_t i = 0; i < registers_.size(); ++i) {
-        if (!registers_[i]) {
-            registers_[i] = true;
-            return i;
+void CodeGeneratorX86::emit_function(ir::Function function) {
+    // Speculating longer arms costs more than the branch mispredictions it saves.
+    constexpr size_t kMaxSpeculated = 8;
+    const size_t kConverted = ir::IfConverter(kMaxSpeculated).Run(function);
+    // Once SSAOptimizer has turned the variables into values, there is nothing left to promote.
+    ir::SSAOptimizer ssa;
+    const bool kSSA = optimize_ && ssa.Run(function);
+    // At most as many as there are callee-saved registers, which is where promoted values go
+    // when the loop calls printint.
+    const size_t kPromoted =
+            ir::RegisterPromoter(registers_names_.size() - kFirstCalleeSaved).Run(function);
+    const size_t kImmediates = select_immediates(function);
+    if (ir_dump_ != nullptr) {
+        *ir_dump_ << function;
+    }
+    function_ = &function;
+    allocation_ =
+            ir::LinearScanAllocator(registers_names_.size(), kFirstCalleeSaved).Run(function);
+    plan_reloads();
+
+    // A compare whose only use is the select right after it just sets the flags for cmov.
+    std::vector<size_t> use_count(function.num_vregs, 0);
+    for (const auto &in : function.code) {
+        for (ir::VReg v : {in.a, in.b, in.c}) {
+            if (v != ir::kNoVReg) {
+                ++use_count[v];
+            }
+        }
+    }
+    fused_compares_.assign(function.code.size(), false);
+    for (size_t i = 0; i + 1 < function.code.size(); ++i) {
+        const auto &in = function.code[i];
+        fused_compares_[i] = in.op == ir::Opcode::kCompare && use_count[in.dst] == 1
+                && function.code[i + 1].op == ir::Opcode::kSelect
+                && function.code[i + 1].a == in.dst;
+    }
+
+    // Loop heads, the labels a later jump or branch goes back to, are aligned for the back edge.
+    loop_heads_.clear();
+    std::unordered_set<int64_t> seen;
+    for (const auto &in : function.code) {
+        if (in.op == ir::Opcode::kLabel) {
+            seen.insert(in.imm);
+        } else if ((in.op == ir::Opcode::kJump || in.op == ir::Opcode::kBranch)
+                   && seen.count(in.imm) != 0) {
+            loop_heads_.insert(in.imm);
         }
     }
-    throw std::runtime_error("No free registers");
+
+    code_.clear();
+    code_.reserve(2 * function.code.size());
+    emit_preemble();
+    emit_prologue();
+    auto reload = reloads_.begin();
+    const auto emit_reloads = [this, &reload](size_t position) {
+        for (; reload != reloads_.end() && std::get<0>(*reload) == position; ++reload) {
+            const auto &[kPosition, kReg, kSlot] = *reload;
+            emit("movq", slot_address(kSlot), registers_names_[kReg]);
+        }
+    };
+    for (size_t i = 0; i < function.code.size(); ++i) {
+        emit_reloads(2 * i);
+        emit_instruction(function.code[i], i);
+        emit_reloads(2 * i + 1);
+    }
+    emit_epilogue();
+
+    PeepholeOptimizer peephole;
+    PrintMachineCode(peephole.Run(std::move(code_)), out_);
+    out_.Flush();
+    code_.clear();
+
+    context_.AddStatistic("ifconvert.branches", kConverted);
+    if (kSSA) {
+        const auto &statistics = ssa.GetStatistics();
+        context_.AddStatistic("ssa.phis", statistics.phis);
+        context_.AddStatistic("ssa.constants", statistics.constants);
+        context_.AddStatistic("ssa.branches", statistics.branches);
+        context_.AddStatistic("ssa.blocks", statistics.blocks);
+        context_.AddStatistic("ssa.redundant", statistics.redundant);
+        context_.AddStatistic("ssa.dead", statistics.dead);
+        context_.AddStatistic("ssa.coalesced", statistics.coalesced);
+        context_.AddStatistic("ssa.copies", statistics.copies);
+    }
+    context_.AddStatistic("promote.variables", kPromoted);
+    context_.AddStatistic("x86.immediates", kImmediates);
+    context_.AddStatistic("regalloc.spilled", allocation_.spilled);
+    context_.AddStatistic("regalloc.splits", allocation_.splits);
+    for (const auto &[name, hits] : peephole.GetHits()) {
+        context_.AddStatistic("peephole." + std::string(name), hits);
+    }
+    function_ = nullptr;
 }
 
-void CodeGeneratorX86::register_free(size_t reg) {
-    if (registers_[reg] != true) {
-        throw std::runtime_error("Register is not allocated");
+// Moves constants into the instructions that use them wherever x86 has an immediate form, or
+// where a constant divisor is cheaper as shifts and a multiplication, and drops the ones no
+// longer needed. Returns how many operands became immediates.
+size_t CodeGeneratorX86::select_immediates(ir::Function &function) {
+    using ir::Opcode;
+    std::vector<size_t> def_count(function.num_vregs, 0), use_count(function.num_vregs, 0);
+    std::vector<bool> constant(function.num_vregs, false);
+    std::vector<int64_t> value(function.num_vregs, 0);
+    for (const auto &in : function.code) {
+        if (in.dst != ir::kNoVReg) {
+            ++def_count[in.dst];
+            if (in.op == Opcode::kConst) {
+                constant[in.dst] = true;
+                value[in.dst] = in.imm;
+            }
+        }
+        for (ir::VReg v : {in.a, in.b, in.c}) {
+            if (v != ir::kNoVReg) {
+                ++use_count[v];
+            }
+        }
     }
-    registers_[reg] = false;
+    // Immediates are sign-extended 32-bit values; a subtrahend is negated for leaq first.
+    const auto kImmediate = [&](ir::VReg v) {
+        return v != ir::kNoVReg && constant[v] && def_count[v] == 1
+                && value[v] > std::numeric_limits<int32_t>::min()
+                && value[v] <= std::numeric_limits<int32_t>::max();
+    };
+
+    size_t folded = 0;
+    for (auto &in : function.code) {
+        switch (in.op) {
+        case Opcode::kAdd:
+        case Opcode::kMul:
+            if (!kImmediate(in.b) && kImmediate(in.a)) {
+                std::swap(in.a, in.b);
+            }
+            break;
+        case Opcode::kCompare:
+        case Opcode::kBranch:
+            if (!kImmediate(in.b) && kImmediate(in.a)) {
+                std::swap(in.a, in.b);
+                in.cond = ir::Swap(in.cond);
+            }
+            break;
+        case Opcode::kSub:
+            break;
+        case Opcode::kDiv:
+            // idivq is kept where it faults: for 0 always, and for -1 on the most negative n.
+            if (kImmediate(in.b) && value[in.b] != 0 && value[in.b] != -1) {
+                break;
+            }
+            continue;
+        default:
+            continue;
+        }
+        if (kImmediate(in.b)) {
+            --use_count[in.b];
+            in.constant = value[in.b];
+            in.b = ir::kNoVReg;
+            ++folded;
+        }
+    }
+    auto &code = function.code;
+    code.erase(
+            std::remove_if(
+                    code.begin(),
+                    code.end(),
+                    [&](const ir::Instruction &in) {
+                        return in.op == Opcode::kConst && def_count[in.dst] == 1
+                                && use_count[in.dst] == 0;
+                    }),
+            code.end());
+    return folded;
 }
 
-void CodeGeneratorX86::registers_free_all() {
-    for (size_t i = 0; i < registers_.size(); ++i) {
-        registers_[i] = false;
+// A spilled value is reloaded where a register segment of it starts, unless the value is written
+// there, and after every label inside one, since the jumps there may come from where it was in
+// memory or in another register. A reload is dropped when the value is not read before the next
+// one or the end of the segment, as the register may then be written first. The slot is always
+// current, so no stores are needed on any edge.
+void CodeGeneratorX86::plan_reloads() {
+    const auto &code = function_->code;
+    std::vector<size_t> labels;
+    std::vector<std::vector<size_t>> reads(function_->num_vregs);
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op == ir::Opcode::kLabel) {
+            labels.push_back(i);
+        }
+        for (ir::VReg v : {code[i].a, code[i].b, code[i].c}) {
+            if (v != ir::kNoVReg) {
+                reads[v].push_back(2 * i);
+            }
+        }
+    }
+    reloads_.clear();
+    std::vector<size_t> points;
+    for (ir::VReg v = 0; v < function_->num_vregs; ++v) {
+        const size_t kSlot = allocation_.slots[v];
+        if (kSlot == ir::Allocation::kNoSlot) {
+            continue;
+        }
+        for (size_t i = allocation_.first[v]; i != ir::Allocation::kNoSegment;
+             i = allocation_.segments[i].next) {
+            const auto &segment = allocation_.segments[i];
+            if (segment.reg == ir::Allocation::kMemory) {
+                continue;
+            }
+            points.clear();
+            const auto &at = code[segment.start / 2];
+            const bool kWritten = segment.start % 2 == 1 && at.dst == v;
+            if (!kWritten && at.op != ir::Opcode::kLabel) {
+                points.push_back(segment.start);
+            }
+            for (auto label = std::lower_bound(labels.begin(), labels.end(), segment.start / 2);
+                 label != labels.end() && 2 * *label + 1 <= segment.end; ++label) {
+                points.push_back(2 * *label + 1);
+            }
+            for (size_t k = 0; k < points.size(); ++k) {
+                const size_t kUntil = k + 1 < points.size() ? points[k + 1] : segment.end + 1;
+                const auto kRead = std::lower_bound(reads[v].begin(), reads[v].end(), points[k]);
+                if (kRead != reads[v].end() && *kRead < kUntil) {
+                    reloads_.emplace_back(points[k], segment.reg, kSlot);
+                }
+            }
+        }
     }
+    std::sort(reloads_.begin(), reloads_.end());
 }
 
-void CodeGeneratorX86::codegen_preemble() {
-    registers_free_all();
-    os_ << "\t.text" << std::endl
-        << ".LC0:" << std::endl
-        << "\t.string\t\"%d\\n\"" << std::endl
-        << "printint:" << std::endl
-        << "\tpushq\t%rbp" << std::endl
-        << "\tmovq\t%rsp, %rbp" << std::endl
-        << "\tsubq\t$16, %rsp" << std::endl
-        << "\tmovl\t%edi, -4(%rbp)" << std::endl
-        << "\tmovl\t-4(%rbp), %eax" << std::endl
-        << "\tmovl\t%eax, %esi" << std::endl
-        << "\tleaq	.LC0(%rip), %rdi" << std::endl
-        << "\tmovl	$0, %eax" << std::endl
-        << "\tcall	printf@PLT" << std::endl
-        << "\tnop" << std::endl
-        << "\tleave" << std::endl
-        << "\tret" << std::endl
-        << "" << std::endl
-        << "\t.globl\tmain" << std::endl
-        << "\t.type\tmain, @function" << std::endl
-        << "main:" << std::endl
-        << "\tpushq\t%rbp" << std::endl
-        << "\tmovq	%rsp, %rbp" << std::endl;
+void CodeGeneratorX86::emit(std::string_view op, Operand src, Operand dst, Operand src2) {
+    code_.push_back({MachineInstruction::Kind::kOperation, op, src, dst, src2, {}});
 }
 
-void CodeGeneratorX86::codegen_postemble() {
-    os_ << "\tmovl	$0, %eax" << std::endl << "\tpopq	%rbp" << std::endl << "\tret" << std::endl;
+void CodeGeneratorX86::emit_label(Operand label) {
+    code_.push_back({MachineInstruction::Kind::kLabel, {}, label, {}, {}, {}});
 }
 
-size_t CodeGeneratorX86::codegen_add(size_t left_reg, size_t right_reg) {
-    os_ << "\taddq\t" << registers_names_[left_reg] << ", " << registers_names_[right_reg]
-        << std::endl;
-    register_free(left_reg);
-    return right_reg;
+void CodeGeneratorX86::emit_directive(std::string text) {
+    code_.push_back({MachineInstruction::Kind::kDirective, {}, {}, {}, {}, std::move(text)});
 }
 
-size_t CodeGeneratorX86::codegen_sub(size_t left_reg, size_t right_reg) {
-    os_ << "\tsubq\t" << registers_names_[right_reg] << ", " << registers_names_[left_reg]
-        << std::endl;
-    register_free(right_reg);
-    return left_reg;
+void CodeGeneratorX86::emit_preemble() {
+    emit_directive(
+            "\t.text\n"
+            ".LC0:\n"
+            "\t.string\t\"%d\\n\"\n"
+            "printint:\n"
+            "\tpushq\t%rbp\n"
+            "\tmovq\t%rsp, %rbp\n"
+            "\tsubq\t$16, %rsp\n"
+            "\tmovl\t%edi, -4(%rbp)\n"
+            "\tmovl\t-4(%rbp), %eax\n"
+            "\tmovl\t%eax, %esi\n"
+            "\tleaq\t.LC0(%rip), %rdi\n"
+            "\tmovl\t$0, %eax\n"
+            "\tcall\tprintf@PLT\n"
+            "\tnop\n"
+            "\tleave\n"
+            "\tret\n"
+            "\n"
+            "\t.globl\tmain\n"
+            "\t.type\tmain, @function\n");
 }
 
-size_t CodeGeneratorX86::codegen_mul(size_t left_reg, size_t right_reg) {
-    os_ << "\timulq\t" << registers_names_[left_reg] << ", " << registers_names_[right_reg]
-        << std::endl;
-    register_free(left_reg);
-    return right_reg;
+// Frame: locals, then spill slots, then the callee-saved registers the code uses.
+void CodeGeneratorX86::emit_prologue() {
+    emit_label(symbol("main"));
+    emit("pushq", "%rbp");
+    emit("movq", "%rsp", "%rbp");
+    size_t saved = 0;
+    for (size_t i = kFirstCalleeSaved; i < registers_names_.size(); ++i) {
+        saved += allocation_.used[i];
+    }
+    // Keep %rsp 16-byte aligned for the calls to printint.
+    const size_t kFrameSize = (slots_end() + SymbolTable::kSlotSize * saved + 15) & ~size_t{15};
+    if (kFrameSize > 0) {
+        emit("subq", immediate(static_cast<int64_t>(kFrameSize)), "%rsp");
+    }
+    size_t offset = slots_end();
+    for (size_t i = kFirstCalleeSaved; i < registers_names_.size(); ++i) {
+        if (allocation_.used[i]) {
+            offset += SymbolTable::kSlotSize;
+            emit("movq", registers_names_[i], frame_address(offset));
+        }
+    }
 }
 
-size_t CodeGeneratorX86::codegen_div(size_t left_reg, size_t right_reg) {
-    os_ << "\tmovq\t" << registers_names_[left_reg] << ", %rax" << std::endl;
-    os_ << "\tcqo" << std::endl;
-    os_ << "\tidivq\t" << registers_names_[right_reg] << std::endl;
-    os_ << "\tmovq\t%rax, " << registers_names_[right_reg] << std::endl;
-    register_free(left_reg);
-    return right_reg;
+void CodeGeneratorX86::emit_epilogue() {
+    size_t offset = slots_end();
+    for (size_t i = kFirstCalleeSaved; i < registers_names_.size(); ++i) {
+        if (allocation_.used[i]) {
+            offset += SymbolTable::kSlotSize;
+            emit("movq", frame_address(offset), registers_names_[i]);
+        }
+    }
+    emit("movl", immediate(0), "%eax");
+    emit("leave");
+    emit("ret");
 }
 
-size_t CodeGeneratorX86::codegen_load_int(size_t value) {
-    size_t reg = registers_alloc();
-    os_ << "\tmovq\t$" << value << ", " << registers_names_[reg] << std::endl;
-    return reg;
+void CodeGeneratorX86::emit_instruction(const ir::Instruction &in, size_t index) {
+    constexpr std::array<std::string_view, 6> kSetCommands =
+            {"sete", "setne", "setl", "setg", "setle", "setge"};
+    constexpr std::array<std::string_view, 6> kJumpCommands =
+            {"je", "jne", "jl", "jg", "jle", "jge"};
+    constexpr std::array<std::string_view, 6> kMoveCommands =
+            {"cmove", "cmovne", "cmovl", "cmovg", "cmovle", "cmovge"};
+    using ir::Opcode;
+
+    switch (in.op) {
+    case Opcode::kConst: {
+        const size_t kReg = result_reg(in.dst, index);
+        // movq only takes a sign-extended 32-bit immediate.
+        const bool kWide = in.imm < std::numeric_limits<int32_t>::min()
+                || in.imm > std::numeric_limits<int32_t>::max();
+        emit(kWide ? "movabsq" : "movq", immediate(in.imm), result_name(kReg));
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kMove: {
+        const auto kSource = reg_name(in.a, index);
+        const size_t kReg = result_reg(in.dst, index);
+        if (result_name(kReg) != kSource) {
+            emit("movq", kSource, result_name(kReg));
+        }
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kLoadGlobal: {
+        const size_t kReg = result_reg(in.dst, index);
+        emit("movq", rip_address(symbol(function_->globals[in.imm])), result_name(kReg));
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kLoadLocal: {
+        const size_t kReg = result_reg(in.dst, index);
+        emit("movq", frame_address(in.imm), result_name(kReg));
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kStoreGlobal:
+        emit("movq", reg_name(in.a, index), rip_address(symbol(function_->globals[in.imm])));
+        break;
+    case Opcode::kStoreLocal:
+        emit("movq", reg_name(in.a, index), frame_address(in.imm));
+        break;
+    case Opcode::kAdd:
+    case Opcode::kMul: {
+        const auto kLeft = reg_name(in.a, index);
+        const size_t kReg = result_reg(in.dst, index);
+        const auto kResult = result_name(kReg);
+        if (in.b == ir::kNoVReg) {
+            if (in.op == Opcode::kAdd) {
+                emit_add_immediate(kLeft, in.constant, kResult);
+            } else {
+                emit_multiply_immediate(kLeft, in.constant, kResult);
+            }
+            write_back(in.dst, kReg);
+            break;
+        }
+        const std::string_view kOp = in.op == Opcode::kAdd ? "addq" : "imulq";
+        const auto kRight = reg_name(in.b, index);
+        if (kResult == kRight) {
+            emit(kOp, kLeft, kResult);
+        } else {
+            if (kResult != kLeft) {
+                emit("movq", kLeft, kResult);
+            }
+            emit(kOp, kRight, kResult);
+        }
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kSub: {
+        const auto kLeft = reg_name(in.a, index);
+        const size_t kReg = result_reg(in.dst, index);
+        const auto kResult = result_name(kReg);
+        if (in.b == ir::kNoVReg) {
+            emit_add_immediate(kLeft, -in.constant, kResult);
+            write_back(in.dst, kReg);
+            break;
+        }
+        const auto kRight = reg_name(in.b, index);
+        if (kResult == kRight && kResult != kLeft) {
+            emit("movq", kLeft, "%rax");
+            emit("subq", kRight, "%rax");
+            emit("movq", "%rax", kResult);
+        } else {
+            if (kResult != kLeft) {
+                emit("movq", kLeft, kResult);
+            }
+            emit("subq", kRight, kResult);
+        }
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kDiv: {
+        const auto kLeft = reg_name(in.a, index);
+        const size_t kReg = result_reg(in.dst, index);
+        if (in.b == ir::kNoVReg) {
+            emit_divide_immediate(kLeft, in.constant, result_name(kReg));
+            write_back(in.dst, kReg);
+            break;
+        }
+        const auto kRight = reg_name(in.b, index);
+        emit("movq", kLeft, "%rax");
+        emit("cqo");
+        emit("idivq", kRight);
+        if (kReg != ir::Allocation::kMemory) {
+            emit("movq", "%rax", result_name(kReg));
+        }
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kCompare: {
+        emit_compare(in, index);
+        if (fused_compares_[index]) {
+            break;
+        }
+        const size_t kReg = result_reg(in.dst, index);
+        emit(kSetCommands[static_cast<size_t>(in.cond)], result_bname(kReg));
+        emit("movzbq", result_bname(kReg), result_name(kReg));
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kBranch:
+        emit_compare(in, index);
+        emit(kJumpCommands[static_cast<size_t>(in.cond)], label_name(".L", in.imm));
+        break;
+    case Opcode::kSelect: {
+        // The flags are set by the compare before, or here from the condition value.
+        ir::Condition cond = ir::Condition::kNe;
+        if (index > 0 && fused_compares_[index - 1]) {
+            cond = function_->code[index - 1].cond;
+        } else {
+            const auto kCondition = reg_name(in.a, index);
+            emit("testq", kCondition, kCondition);
+        }
+        const auto kTrue = reg_name(in.b, index);
+        const auto kFalse = reg_name(in.c, index);
+        const size_t kReg = result_reg(in.dst, index);
+        const auto kResult = result_name(kReg);
+        if (kResult == kTrue && kResult != kFalse) {
+            emit(kMoveCommands[static_cast<size_t>(ir::Negate(cond))], kFalse, kResult);
+        } else {
+            if (kResult != kFalse) {
+                emit("movq", kFalse, kResult);
+            }
+            emit(kMoveCommands[static_cast<size_t>(cond)], kTrue, kResult);
+        }
+        write_back(in.dst, kReg);
+        break;
+    }
+    case Opcode::kJump:
+        emit("jmp", label_name(".L", in.imm));
+        break;
+    case Opcode::kLabel:
+        if (loop_heads_.count(in.imm) != 0) {
+            emit_directive("\t.p2align\t4\n");
+        }
+        emit_label(label_name(".L", in.imm));
+        break;
+    case Opcode::kPrint:
+        emit("movq", reg_name(in.a, index), "%rdi");
+        emit("call", symbol("printint"));
+        break;
+    case Opcode::kText:
+        emit_text(function_->texts[in.imm]);
+        break;
+    case Opcode::kGlobal:
+        emit_directive("\t.comm\t" + function_->globals[in.imm] + ",8,8\n");
+        break;
+    }
 }
 
-size_t CodeGeneratorX86::codegen_load_gblob(const std::string &identifier) {
-    size_t reg = registers_alloc();
-    os_ << "\tmovq\t" << identifier << "(%rip), " << registers_names_[reg] << std::endl;
-    return reg;
+// dst = src + value, in place when it can be and through leaq otherwise.
+void CodeGeneratorX86::emit_add_immediate(
+        std::string_view src,
+        int64_t value,
+        std::string_view dst) {
+    if (value == 0) {
+        if (dst != src) {
+            emit("movq", src, dst);
+        }
+    } else if (dst == src) {
+        emit(value > 0 ? "addq" : "subq", immediate(value > 0 ? value : -value), dst);
+    } else {
+        emit("leaq", memory(value, src), dst);
+    }
 }
 
-size_t CodeGeneratorX86::codegen_store_gblob(size_t reg, const std::string &identifier) {
-    os_ << "\tmovq\t" << registers_names_[reg] << ", " << identifier << "(%rip)" << std::endl;
-    register_free(reg);
-    return reg;
+// dst = src * value without imulq where a shift or one leaq does: powers of two, and 3, 5 and 9
+// as x + 2x, x + 4x and x + 8x. Anything else multiplies by the immediate directly.
+void CodeGeneratorX86::emit_multiply_immediate(
+        std::string_view src,
+        int64_t value,
+        std::string_view dst) {
+    const auto copy = [&] {
+        if (dst != src) {
+            emit("movq", src, dst);
+        }
+    };
+    if (value == 0) {
+        emit("movq", immediate(0), dst);
+    } else if (value == 1) {
+        copy();
+    } else if (value == -1) {
+        copy();
+        emit("negq", dst);
+    } else if (value > 0 && (value & (value - 1)) == 0) {
+        int shift = 0;
+        while ((int64_t{1} << shift) != value) {
+            ++shift;
+        }
+        if (dst != src && shift <= 3) {
+            emit("leaq", memory(0, {}, src, static_cast<uint8_t>(value)), dst);
+        } else {
+            copy();
+            emit("shlq", immediate(shift), dst);
+        }
+    } else if (value == 3 || value == 5 || value == 9) {
+        emit("leaq", memory(0, src, src, static_cast<uint8_t>(value - 1)), dst);
+    } else {
+        emit("imulq", immediate(value), dst, src);
+    }
 }
 
-void CodeGeneratorX86::codegen_label(size_t label) {
-    os_ << ".L" << label << ":" << std::endl;
+// dst = src / value, rounded toward zero like idivq, without it. A power of two is an arithmetic
+// shift after adding 2^k - 1 to negative dividends; anything else takes the high half of a
+// multiplication by the magic number, corrected by the dividend where the multiplier's sign
+// differs from the divisor's, plus one for negative quotients. Only %rax and %rdx are
+// clobbered, as with idivq; value is never 0 or -1.
+void CodeGeneratorX86::emit_divide_immediate(
+        std::string_view src,
+        int64_t value,
+        std::string_view dst) {
+    const uint64_t kAbs = value < 0 ? 0 - static_cast<uint64_t>(value)
+                                    : static_cast<uint64_t>(value);
+    if (kAbs == 1) {
+        if (dst != src) {
+            emit("movq", src, dst);
+        }
+        return;
+    }
+    if ((kAbs & (kAbs - 1)) == 0) {
+        int shift = 0;
+        while ((uint64_t{1} << shift) != kAbs) {
+            ++shift;
+        }
+        emit("movq", src, "%rax");
+        if (shift > 1) {
+            emit("sarq", immediate(63), "%rax");
+        }
+        emit("shrq", immediate(64 - shift), "%rax");
+        emit("addq", src, "%rax");
+        emit("sarq", immediate(shift), "%rax");
+        if (value < 0) {
+            emit("negq", "%rax");
+        }
+        if (dst != "%rax") {
+            emit("movq", "%rax", dst);
+        }
+        return;
+    }
+    const Magic kMagic = signed_magic(value);
+    const bool kWide = kMagic.multiplier < std::numeric_limits<int32_t>::min()
+            || kMagic.multiplier > std::numeric_limits<int32_t>::max();
+    emit(kWide ? "movabsq" : "movq", immediate(kMagic.multiplier), "%rax");
+    emit("imulq", src);
+    if (value > 0 && kMagic.multiplier < 0) {
+        emit("addq", src, "%rdx");
+    } else if (value < 0 && kMagic.multiplier > 0) {
+        emit("subq", src, "%rdx");
+    }
+    if (kMagic.shift > 0) {
+        emit("sarq", immediate(kMagic.shift), "%rdx");
+    }
+    emit("movq", "%rdx", "%rax");
+    emit("shrq", immediate(63), "%rax");
+    emit("addq", "%rax", "%rdx");
+    emit("movq", "%rdx", dst);
+}
+
+// Sets the flags for a compare or branch; a compare with zero only needs testq.
+void CodeGeneratorX86::emit_compare(const ir::Instruction &in, size_t index) {
+    const auto kLeft = reg_name(in.a, index);
+    if (in.b != ir::kNoVReg) {
+        emit("cmpq", reg_name(in.b, index), kLeft);
+    } else if (in.constant == 0) {
+        emit("testq", kLeft, kLeft);
+    } else {
+        emit("cmpq", immediate(in.constant), kLeft);
+    }
 }
 
-void CodeGeneratorX86::codegen_jump(size_t label) {
-    os_ << "\tjmp\t.L" << label << std::endl;
+// The text goes to .rodata in lines of at most kTextChunk bytes and is printed with one printf.
+void CodeGeneratorX86::emit_text(std::string_view text) {
+    constexpr size_t kTextChunk = 64;
+    const int64_t kLabel = static_cast<int64_t>(context_.NewLabel());
+    const std::string kNumber = std::to_string(kLabel);
+    std::string data = "\t.section\t.rodata\n.LS" + kNumber + ":\n"
+            + "\t.string\t\"%s\"\n.LT" + kNumber + ":\n";
+    for (size_t begin = 0; begin < text.size(); begin += kTextChunk) {
+        data += "\t.ascii\t\"";
+        for (char c : text.substr(begin, kTextChunk)) {
+            if (c == '\n') {
+                data += "\\n";
+            } else {
+                if (c == '"' || c == '\\') {
+                    data += '\\';
+                }
+                data += c;
+            }
+        }
+        data += "\"\n";
+    }
+    data += "\t.byte\t0\n\t.text\n";
+    emit_directive(std::move(data));
+    emit("leaq", rip_address(label_name(".LT", kLabel)), "%rsi");
+    emit("leaq", rip_address(label_name(".LS", kLabel)), "%rdi");
+    emit("movl", immediate(0), "%eax");
+    emit("call", symbol("printf@PLT"));
 }
 
-size_t CodeGeneratorX86::codegen_compare_and_set(
-        ASTNode::Type op,
-        size_t left_reg,
-        size_t right_reg) {
-    constexpr std::array<const char *, 6> compare_cmds_ =
-            {"sete", "setne", "setl", "setg", "setle", "setge"};
-    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
-        throw std::runtime_error("Invalid operation");
-    }
-
-    os_ << "\tcmpq\t" << registers_names_[right_reg] << ", " << registers_names_[left_reg]
-        << std::endl;
-    os_ << "\t" << compare_cmds_[static_cast<size_t>(op) - static_cast<size_t>(ASTNode::Type::A_EQ)]
-        << "\t" << bregisters_names_[right_reg] << std::endl;
-    os_ << "\tmovzbq\t" << bregisters_names_[right_reg] << ", " << registers_names_[right_reg]
-        << std::endl;
-    register_free(left_reg);
-    return right_reg;
-}
-
-size_t CodeGeneratorX86::codegen_compare_and_jump(
-        ASTNode::Type op,
-        size_t left_reg,
-        size_t right_reg,
-        size_t jump_reg) {
-    constexpr std::array<const char *, 6> compare_cmds_ = {"jne", "je", "jge", "jle", "jg", "jl"};
-    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
-        throw std::runtime_error("Invalid operation");
-    }
-    os_ << "\tcmpq\t" << registers_names_[right_reg] << ", " << registers_names_[left_reg]
-        << std::endl;
-    os_ << "\t" << compare_cmds_[static_cast<size_t>(op) - static_cast<size_t>(ASTNode::Type::A_EQ)]
-        << "\t"
-        << ".L" << jump_reg << std::endl;
-    registers_free_all();
-    return kNoRegister;
-}
-
-size_t CodeGeneratorX86::codegen_compare(
-        size_t left_reg,
-        size_t right_reg,
-        const std::string &cmp) {
-    os_ << "\tcmpq\t" << registers_names_[right_reg] << ", " << registers_names_[left_reg]
-        << std::endl;
-    os_ << "\t" << cmp << "\t" << bregisters_names_[right_reg] << std::endl;
-    os_ << "\tandq\t$255, " << registers_names_[right_reg] << std::endl;
-    register_free(left_reg);
-    return right_reg;
-}
-
-void CodeGeneratorX86::codegen_symbol(const std::string &identifier) {
-    os_ << "\t.comm\t" << identifier << ",8,8" << std::endl;
-}
-
-void CodeGeneratorX86::codegen_printint(size_t reg) {
-    os_ << "\tmovq\t" << registers_names_[reg] << ", %rdi" << std::endl;
-    os_ << "\tcall\tprintint" << std::endl;
-    register_free(reg);
-}
-}  // namespace my_cpp
\ No newline at end of file
+std::string_view CodeGeneratorX86::reg_name(ir::VReg vreg, size_t index) const {
+    const size_t kReg = allocation_.RegisterAt(vreg, 2 * index);
+    if (kReg == ir::Allocation::kMemory) {
+        throw std::runtime_error("Operand is not in a register");
+    }
+    return registers_names_[kReg];
+}
+
+size_t CodeGeneratorX86::result_reg(ir::VReg vreg, size_t index) const {
+    return allocation_.RegisterAt(vreg, 2 * index + 1);
+}
+
+std::string_view CodeGeneratorX86::result_name(size_t reg) const {
+    return reg == ir::Allocation::kMemory ? "%rax" : registers_names_[reg];
+}
+
+std::string_view CodeGeneratorX86::result_bname(size_t reg) const {
+    return reg == ir::Allocation::kMemory ? "%al" : bregisters_names_[reg];
+}
+
+void CodeGeneratorX86::write_back(ir::VReg vreg, size_t reg) {
+    if (allocation_.slots[vreg] != ir::Allocation::kNoSlot) {
+        emit("movq", result_name(reg), slot_address(allocation_.slots[vreg]));
+    }
+}
+
+Operand CodeGeneratorX86::slot_address(size_t slot) const {
+    return frame_address(
+            context_.GetSymbolTable().GetFrameSize() + SymbolTable::kSlotSize * (slot + 1));
+}
+
+size_t CodeGeneratorX86::slots_end() const {
+    return context_.GetSymbolTable().GetFrameSize()
+            + SymbolTable::kSlotSize * allocation_.num_slots;
+}
+}  // namespace my_cpp
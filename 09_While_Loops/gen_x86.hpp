@@ -1,50 +1,102 @@
 #pragma once
 
-#include "gen.hpp"
+#include "ast.hpp"
+#include "context.hpp"
+#include "ir.hpp"
+#include "output.hpp"
+#include "peephole.hpp"
+#include "peval.hpp"
+#include "regalloc.hpp"
 // Standard includes
 // C++ Standard
+#include <array>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_set>
 #include <vector>
 // C Standard
+#include <cstddef>
+#include <cstdint>
 
 namespace my_cpp {
-class CodeGeneratorX86 : public CodeGenerator {
+// GNU assembly for x86-64. The program is lowered to ir::Function by IRBuilder, simple ifs become
+// selects, SSAOptimizer turns the variables into values and optimizes them (or, with it off, the
+// variables hot in loops are promoted to virtual registers), those are allocated by
+// LinearScanAllocator, and the allocated code is turned into machine instructions, cleaned up by
+// PeepholeOptimizer and printed.
+class CodeGeneratorX86 {
 public:
-    CodeGeneratorX86(std::ostream &os);
-    virtual ~CodeGeneratorX86() = default;
+    // With `ir_dump`, the IR is listed there once its passes are done, before allocation.
+    CodeGeneratorX86(
+            CompilationContext &context,
+            std::ostream &os,
+            bool optimize = true,
+            std::ostream *ir_dump = nullptr);
+    ~CodeGeneratorX86() = default;
+    void GenerateCode(const ASTNode &root);
+    void GenerateResidual(const PartialEvaluation &evaluation);
 
 private:
-    std::vector<bool> registers_;
-    std::vector<std::string> registers_names_;
-    std::vector<std::string> bregisters_names_;
-    size_t registers_alloc() override final;
-    void register_free(size_t reg) override final;
-    void registers_free_all() override final;
-
-    void codegen_preemble() override final;
-    void codegen_postemble() override final;
-
-    size_t codegen_add(size_t left_reg, size_t right_reg) override final;
-    size_t codegen_sub(size_t left_reg, size_t right_reg) override final;
-    size_t codegen_mul(size_t left_reg, size_t right_reg) override final;
-    size_t codegen_div(size_t left_reg, size_t right_reg) override final;
-    size_t codegen_load_int(size_t value) override final;
-    size_t codegen_load_gblob(const std::string &identifier) override final;
-    size_t codegen_store_gblob(size_t reg, const std::string &identifier) override final;
-    void codegen_label(size_t label) override final;
-    void codegen_jump(size_t label) override final;
-
-    size_t codegen_compare_and_jump(
-            ASTNode::Type op,
-            size_t left_reg,
-            size_t right_reg,
-            size_t jump_reg) override final;
-    size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg);
-
-    size_t codegen_compare(size_t left_reg, size_t right_reg, const std::string &cmp);
-
-    void codegen_symbol(const std::string &identifier) override final;
-
-    void codegen_printint(size_t reg) override final;
+    // Every general-purpose register except %rsp/%rbp and the %rax/%rdx pair idivq uses; %rax
+    // is also the scratch register for results that go to memory. Caller-saved ones come first;
+    // from kFirstCalleeSaved on, main saves a register in its prologue if the code uses it.
+    static constexpr std::array<std::string_view, 12> registers_names_ = {
+            "%r8", "%r9", "%r10", "%r11", "%rcx", "%rsi", "%rdi",
+            "%rbx", "%r12", "%r13", "%r14", "%r15"};
+    static constexpr std::array<std::string_view, 12> bregisters_names_ = {
+            "%r8b", "%r9b", "%r10b", "%r11b", "%cl", "%sil", "%dil",
+            "%bl", "%r12b", "%r13b", "%r14b", "%r15b"};
+    static constexpr size_t kFirstCalleeSaved = 7;
+
+    CompilationContext &context_;
+    std::ostream &os_;
+    // Whether SSAOptimizer runs.
+    bool optimize_;
+    std::ostream *ir_dump_;
+    // All assembly goes through here rather than straight to os_.
+    TextBuffer out_;
+    const ir::Function *function_ = nullptr;
+    ir::Allocation allocation_;
+    // Reloads of spilled values into their register, as (position, register, slot): before the
+    // instruction at an even position, after the label at an odd one.
+    std::vector<std::tuple<size_t, size_t, size_t>> reloads_;
+
+    // Per instruction, whether it is a compare that only sets the flags for the next select.
+    std::vector<bool> fused_compares_;
+    // Labels that start a loop, which are aligned to 16 bytes.
+    std::unordered_set<int64_t> loop_heads_;
+
+    // main's code, printed once it is complete.
+    std::vector<MachineInstruction> code_;
+
+    void emit_function(ir::Function function);
+    size_t select_immediates(ir::Function &function);
+    void plan_reloads();
+    void emit_preemble();
+    void emit_prologue();
+    void emit_epilogue();
+    void emit_instruction(const ir::Instruction &in, size_t index);
+    void emit_add_immediate(std::string_view src, int64_t value, std::string_view dst);
+    void emit_multiply_immediate(std::string_view src, int64_t value, std::string_view dst);
+    void emit_divide_immediate(std::string_view src, int64_t value, std::string_view dst);
+    void emit_compare(const ir::Instruction &in, size_t index);
+    void emit_text(std::string_view text);
+    // Register operands may be given by name; nothing is formatted until the code is printed.
+    void emit(std::string_view op, Operand src = {}, Operand dst = {}, Operand src2 = {});
+    void emit_label(Operand label);
+    void emit_directive(std::string text);
+
+    // The register holding an operand, which the allocator guarantees at every read.
+    std::string_view reg_name(ir::VReg vreg, size_t index) const;
+    // Where a result is computed: its register, or %rax when it goes straight to memory.
+    size_t result_reg(ir::VReg vreg, size_t index) const;
+    std::string_view result_name(size_t reg) const;
+    std::string_view result_bname(size_t reg) const;
+    // Stores a result held in `reg` to its stack slot, if it has one.
+    void write_back(ir::VReg vreg, size_t reg);
+    Operand slot_address(size_t slot) const;
+    size_t slots_end() const;
 };
-}  // namespace my_cpp
\ No newline at end of file
+}  // namespace my_cpp
@@ -0,0 +1,207 @@
+#include "ifconvert.hpp"
+// Standard includes
+// C++ Standard
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+namespace ir {
+namespace {
+// A variable as stores name it: whether it is a local, and its global index or frame offset.
+using Variable = std::pair<bool, int64_t>;
+
+// Instructions [begin, end): nothing, or values computed and the last one a store.
+struct Arm {
+    size_t begin;
+    size_t end;
+
+    bool Empty() const {
+        return begin == end;
+    }
+};
+
+std::optional<Variable> stored_variable(const Instruction &in) {
+    switch (in.op) {
+    case Opcode::kStoreGlobal:
+        return Variable{false, in.imm};
+    case Opcode::kStoreLocal:
+        return Variable{true, in.imm};
+    default:
+        return std::nullopt;
+    }
+}
+
+Instruction make_access(const Variable &variable, bool load, VReg reg) {
+    Instruction in;
+    if (load) {
+        in.op = variable.first ? Opcode::kLoadLocal : Opcode::kLoadGlobal;
+        in.dst = reg;
+    } else {
+        in.op = variable.first ? Opcode::kStoreLocal : Opcode::kStoreGlobal;
+        in.a = reg;
+    }
+    in.imm = variable.second;
+    return in;
+}
+
+// Whether the instruction may run when its arm would not have: it only computes a value and
+// cannot fault. `constants` holds the constants the arm has defined so far.
+bool speculatable(const Instruction &in, const std::unordered_map<VReg, int64_t> &constants) {
+    switch (in.op) {
+    case Opcode::kConst:
+    case Opcode::kMove:
+    case Opcode::kLoadGlobal:
+    case Opcode::kLoadLocal:
+    case Opcode::kAdd:
+    case Opcode::kSub:
+    case Opcode::kMul:
+    case Opcode::kCompare:
+    case Opcode::kSelect:
+        return true;
+    case Opcode::kDiv: {
+        int64_t divisor = in.constant;
+        if (in.b != kNoVReg) {
+            auto it = constants.find(in.b);
+            if (it == constants.end()) {
+                return false;
+            }
+            divisor = it->second;
+        }
+        return divisor != 0 && divisor != -1;
+    }
+    default:
+        return false;
+    }
+}
+}  // namespace
+
+IfConverter::IfConverter(size_t max_speculated) : max_speculated_(max_speculated) {
+}
+
+size_t IfConverter::Run(Function &function) {
+    // An if converted in one round can make the arm of the one around it convertible.
+    size_t converted = 0;
+    while (const size_t kRound = convert(function)) {
+        converted += kRound;
+    }
+    return converted;
+}
+
+// One pass over the code: the branch to the else arm (or past the then arm), the then arm, the
+// jump over the else arm and its label if there is one, the else arm and the label after it.
+// The labels must not be reached from anywhere else.
+size_t IfConverter::convert(Function &function) {
+    const auto &code = function.code;
+    std::unordered_map<int64_t, size_t> label_at, references;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op == Opcode::kLabel) {
+            label_at[code[i].imm] = i;
+        } else if (code[i].op == Opcode::kJump || code[i].op == Opcode::kBranch) {
+            ++references[code[i].imm];
+        }
+    }
+    const auto kForwardOnce = [&](int64_t label, size_t after) -> std::optional<size_t> {
+        auto it = label_at.find(label);
+        if (it == label_at.end() || it->second <= after || references[label] != 1) {
+            return std::nullopt;
+        }
+        return it->second;
+    };
+    const auto kConvertible = [&](const Arm &arm) {
+        if (arm.Empty()) {
+            return true;
+        }
+        if (arm.end - arm.begin - 1 > max_speculated_ || !stored_variable(code[arm.end - 1])) {
+            return false;
+        }
+        std::unordered_map<VReg, int64_t> constants;
+        for (size_t i = arm.begin; i + 1 < arm.end; ++i) {
+            if (!speculatable(code[i], constants)) {
+                return false;
+            }
+            if (code[i].op == Opcode::kConst) {
+                constants[code[i].dst] = code[i].imm;
+            }
+        }
+        return true;
+    };
+
+    std::vector<Instruction> out;
+    size_t copied = 0;
+    size_t converted = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const Instruction &branch = code[i];
+        if (branch.op != Opcode::kBranch) {
+            continue;
+        }
+        const auto kElse = kForwardOnce(branch.imm, i);
+        if (!kElse) {
+            continue;
+        }
+        Arm then_arm{i + 1, *kElse}, else_arm{*kElse + 1, *kElse + 1};
+        size_t end = *kElse;
+        if (*kElse > i + 1 && code[*kElse - 1].op == Opcode::kJump) {
+            const auto kJoin = kForwardOnce(code[*kElse - 1].imm, *kElse);
+            if (!kJoin) {
+                continue;
+            }
+            then_arm.end = *kElse - 1;
+            else_arm.end = *kJoin;
+            end = *kJoin;
+        }
+        if ((then_arm.Empty() && else_arm.Empty()) || !kConvertible(then_arm)
+            || !kConvertible(else_arm)) {
+            continue;
+        }
+        const auto kThenVariable =
+                then_arm.Empty() ? std::nullopt : stored_variable(code[then_arm.end - 1]);
+        const auto kElseVariable =
+                else_arm.Empty() ? std::nullopt : stored_variable(code[else_arm.end - 1]);
+        if (kThenVariable && kElseVariable && *kThenVariable != *kElseVariable) {
+            continue;
+        }
+        const Variable kVariable = kThenVariable ? *kThenVariable : *kElseVariable;
+
+        out.insert(out.end(), code.begin() + copied, code.begin() + i);
+        VReg values[2];
+        for (size_t side = 0; side < 2; ++side) {
+            const Arm &arm = side == 0 ? then_arm : else_arm;
+            if (arm.Empty()) {
+                values[side] = static_cast<VReg>(function.num_vregs++);
+                out.push_back(make_access(kVariable, true, values[side]));
+            } else {
+                out.insert(out.end(), code.begin() + arm.begin, code.begin() + arm.end - 1);
+                values[side] = code[arm.end - 1].a;
+            }
+        }
+        // The branch jumped to the else arm when its condition held.
+        Instruction compare = branch;
+        compare.op = Opcode::kCompare;
+        compare.dst = static_cast<VReg>(function.num_vregs++);
+        compare.imm = 0;
+        Instruction select;
+        select.op = Opcode::kSelect;
+        select.dst = static_cast<VReg>(function.num_vregs++);
+        select.a = compare.dst;
+        select.b = values[1];
+        select.c = values[0];
+        out.push_back(compare);
+        out.push_back(select);
+        out.push_back(make_access(kVariable, false, select.dst));
+        copied = end + 1;
+        i = end;
+        ++converted;
+    }
+    if (converted == 0) {
+        return 0;
+    }
+    out.insert(out.end(), code.begin() + copied, code.end());
+    function.code = std::move(out);
+    return converted;
+}
+}  // namespace ir
+}  // namespace my_cpp
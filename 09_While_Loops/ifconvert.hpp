@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+namespace ir {
+// Replaces an if whose arms each either do nothing or assign one variable, the same one, with
+// straight-line code: both arms' values are computed, a kSelect picks one by the condition and
+// a single store writes it. An empty arm keeps the variable's old value. Arms may only compute
+// values that cannot fault, in at most max_speculated instructions each, since both now run;
+// a division is allowed only by a constant that idivq cannot fault on.
+class IfConverter {
+public:
+    explicit IfConverter(size_t max_speculated);
+    // Returns the number of ifs converted, nested ones included.
+    size_t Run(Function &function);
+
+private:
+    size_t max_speculated_;
+
+    size_t convert(Function &function);
+};
+}  // namespace ir
+}  // namespace my_cpp
@@ -0,0 +1,111 @@
+#include "interp.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+#include <stdexcept>
+// C Standard
+
+namespace my_cpp {
+Interpreter::Interpreter(const CompilationContext &context, std::ostream &os)
+    : context_(context), output_(os) {
+}
+
+void Interpreter::Run(const ASTNode &root) {
+    reset();
+    exec(root);
+    output_.Flush();
+}
+
+void Interpreter::reset() {
+    const auto &symbols = context_.GetSymbolTable();
+    slots_.assign(symbols.GetSlotCount(), 0);
+    symbol_slots_.resize(symbols.Size());
+    for (size_t id = 0; id < symbol_slots_.size(); ++id) {
+        symbol_slots_[id] = symbols.GetSlot(id);
+    }
+}
+
+void Interpreter::exec(const ASTNode &node) {
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_GLUE:
+        if (node.GetLeft() != nullptr) {
+            exec(*node.GetLeft());
+        }
+        if (node.GetRight() != nullptr) {
+            exec(*node.GetRight());
+        }
+        break;
+    case ASTNode::Type::A_IF:
+        if (eval(*node.GetLeft()) != 0) {
+            if (node.GetMiddle() != nullptr) {
+                exec(*node.GetMiddle());
+            }
+        } else if (node.GetRight() != nullptr) {
+            exec(*node.GetRight());
+        }
+        break;
+    case ASTNode::Type::A_WHILE:
+        exec_while(node);
+        break;
+    case ASTNode::Type::A_ASSIGN:
+        slots_[symbol_slots_[node.GetRight()->GetValue<size_t>()]] = eval(*node.GetLeft());
+        break;
+    case ASTNode::Type::A_PRINT:
+        output_.PrintInt(eval(*node.GetLeft()));
+        break;
+    case ASTNode::Type::A_VAR_DECL:
+        // Every declaration starts the variable at 0, as the compiled code does.
+        slots_[symbol_slots_[node.GetValue<size_t>()]] = 0;
+        break;
+    default:
+        throw std::runtime_error("Invalid statement");
+    }
+}
+
+void Interpreter::exec_while(const ASTNode &while_stmt) {
+    while (eval(*while_stmt.GetLeft()) != 0) {
+        if (while_stmt.GetRight() != nullptr) {
+            exec(*while_stmt.GetRight());
+        }
+    }
+}
+
+int64_t Interpreter::eval(const ASTNode &node) {
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_INTLIT:
+        return node.GetValue<int>();
+    case ASTNode::Type::A_IDENT:
+        return slots_[symbol_slots_[node.GetValue<size_t>()]];
+    default:
+        break;
+    }
+
+    const int64_t kLeft = eval(*node.GetLeft());
+    const int64_t kRight = eval(*node.GetRight());
+    switch (node.GetOp()) {
+    case ASTNode::Type::A_ADD:
+        return arith::Add(kLeft, kRight);
+    case ASTNode::Type::A_SUBTRACT:
+        return arith::Sub(kLeft, kRight);
+    case ASTNode::Type::A_MULTIPLY:
+        return arith::Mul(kLeft, kRight);
+    case ASTNode::Type::A_DIVIDE:
+        return arith::Div(kLeft, kRight);
+    case ASTNode::Type::A_EQ:
+        return kLeft == kRight;
+    case ASTNode::Type::A_NE:
+        return kLeft != kRight;
+    case ASTNode::Type::A_LT:
+        return kLeft < kRight;
+    case ASTNode::Type::A_GT:
+        return kLeft > kRight;
+    case ASTNode::Type::A_LE:
+        return kLeft <= kRight;
+    case ASTNode::Type::A_GE:
+        return kLeft >= kRight;
+    default:
+        throw std::runtime_error("Invalid expression");
+    }
+}
+}  // namespace my_cpp
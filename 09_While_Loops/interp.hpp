@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ast.hpp"
+#include "context.hpp"
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <ostream>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Tree-walking interpreter for whole programs (the --run mode). Variables live in a dense slot
+// array laid out by SymbolTable::GetSlot() and values follow the generated code: 64-bit wrapping
+// arithmetic, with print showing the low 32 bits like printint does.
+class Interpreter {
+public:
+    Interpreter(const CompilationContext &context, std::ostream &os);
+    virtual ~Interpreter() = default;
+    void Run(const ASTNode &root);
+
+protected:
+    const CompilationContext &context_;
+    OutputBuffer output_;
+    std::vector<int64_t> slots_;
+
+    // Zeroes every variable.
+    void reset();
+    virtual void exec_while(const ASTNode &while_stmt);
+    void exec(const ASTNode &node);
+    int64_t eval(const ASTNode &node);
+
+private:
+    // Slot of every symbol id.
+    std::vector<size_t> symbol_slots_;
+};
+}  // namespace my_cpp
@@ -0,0 +1,132 @@
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+#include <array>
+#include <stdexcept>
+#include <string_view>
+// C Standard
+
+namespace my_cpp {
+namespace ir {
+Condition Negate(Condition cond) {
+    switch (cond) {
+    case Condition::kEq:
+        return Condition::kNe;
+    case Condition::kNe:
+        return Condition::kEq;
+    case Condition::kLt:
+        return Condition::kGe;
+    case Condition::kGt:
+        return Condition::kLe;
+    case Condition::kLe:
+        return Condition::kGt;
+    case Condition::kGe:
+        return Condition::kLt;
+    }
+    throw std::runtime_error("Invalid condition");
+}
+
+Condition Swap(Condition cond) {
+    switch (cond) {
+    case Condition::kLt:
+        return Condition::kGt;
+    case Condition::kGt:
+        return Condition::kLt;
+    case Condition::kLe:
+        return Condition::kGe;
+    case Condition::kGe:
+        return Condition::kLe;
+    default:
+        return cond;
+    }
+}
+
+Condition ConditionOf(ASTNode::Type op) {
+    if (!(ASTNode::Type::A_EQ <= op && op <= ASTNode::Type::A_GE)) {
+        throw std::runtime_error("Invalid comparison operator");
+    }
+    return static_cast<Condition>(
+            static_cast<size_t>(op) - static_cast<size_t>(ASTNode::Type::A_EQ));
+}
+
+bool IsCall(const Instruction &in) {
+    return in.op == Opcode::kPrint || in.op == Opcode::kText;
+}
+
+bool FallsThrough(const Instruction &in) {
+    return in.op != Opcode::kJump;
+}
+}  // namespace ir
+}  // namespace my_cpp
+
+std::ostream &operator<<(std::ostream &os, const my_cpp::ir::Function &function) {
+    using my_cpp::ir::Opcode;
+    constexpr std::array<std::string_view, 18> kOpcodeNames = {
+            "const", "move", "loadg", "storeg", "loadl", "storel", "add",   "sub",  "mul",
+            "div",   "cmp",  "br",    "sel",    "jmp",   "label",  "print", "text", "global"};
+    constexpr std::array<std::string_view, 6> kConditionNames = {
+            "eq", "ne", "lt", "gt", "le", "ge"};
+    const auto vreg = [&os](my_cpp::ir::VReg v) -> std::ostream & { return os << "v" << v; };
+    const auto right = [&os, &vreg](const my_cpp::ir::Instruction &in) -> std::ostream & {
+        return in.b != my_cpp::ir::kNoVReg ? vreg(in.b) : os << "$" << in.constant;
+    };
+    for (const auto &in : function.code) {
+        if (in.op == Opcode::kLabel) {
+            os << ".L" << in.imm << ":\n";
+            continue;
+        }
+        os << "\t" << kOpcodeNames[static_cast<size_t>(in.op)];
+        if (in.op == Opcode::kCompare || in.op == Opcode::kBranch) {
+            os << "." << kConditionNames[static_cast<size_t>(in.cond)];
+        }
+        os << "\t";
+        if (in.dst != my_cpp::ir::kNoVReg) {
+            vreg(in.dst) << " = ";
+        }
+        switch (in.op) {
+        case Opcode::kConst:
+            os << "$" << in.imm;
+            break;
+        case Opcode::kLoadGlobal:
+        case Opcode::kGlobal:
+            os << function.globals[in.imm];
+            break;
+        case Opcode::kStoreGlobal:
+            os << function.globals[in.imm] << ", ";
+            vreg(in.a);
+            break;
+        case Opcode::kLoadLocal:
+            os << "-" << in.imm << "(fp)";
+            break;
+        case Opcode::kStoreLocal:
+            os << "-" << in.imm << "(fp), ";
+            vreg(in.a);
+            break;
+        case Opcode::kBranch:
+            vreg(in.a) << ", ";
+            right(in) << ", .L" << in.imm;
+            break;
+        case Opcode::kSelect:
+            vreg(in.a) << ", ";
+            vreg(in.b) << ", ";
+            vreg(in.c);
+            break;
+        case Opcode::kJump:
+            os << ".L" << in.imm;
+            break;
+        case Opcode::kMove:
+        case Opcode::kPrint:
+            vreg(in.a);
+            break;
+        case Opcode::kText:
+            os << "#" << in.imm;
+            break;
+        default:
+            vreg(in.a) << ", ";
+            right(in);
+            break;
+        }
+        os << "\n";
+    }
+    return os;
+}
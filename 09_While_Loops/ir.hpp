@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ast.hpp"
+// Standard includes
+// C++ Standard
+#include <ostream>
+#include <string>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Linear three-address code for main. Values live in virtual registers, numbered densely from 0,
+// which a register allocator later maps to machine registers or stack slots; variables stay in
+// memory and are reached through explicit loads and stores.
+namespace ir {
+using VReg = uint32_t;
+constexpr VReg kNoVReg = static_cast<VReg>(-1);
+
+enum class Opcode : uint8_t {
+    kConst,        // dst = imm
+    kMove,         // dst = a
+    kLoadGlobal,   // dst = globals[imm]
+    kStoreGlobal,  // globals[imm] = a
+    kLoadLocal,    // dst = local at frame offset imm
+    kStoreLocal,   // local at frame offset imm = a
+    kAdd,          // dst = a + b
+    kSub,          // dst = a - b
+    kMul,          // dst = a * b
+    kDiv,          // dst = a / b
+    kCompare,      // dst = a cond b ? 1 : 0
+    kBranch,       // if (a cond b) goto label imm
+    // In the six above, b may be kNoVReg and its value given by `constant` instead.
+    kSelect,       // dst = a != 0 ? b : c
+    kJump,         // goto label imm
+    kLabel,        // label imm:
+    kPrint,        // printint(a)
+    kText,         // print texts[imm] as it is
+    kGlobal,       // storage for globals[imm]
+};
+
+enum class Condition : uint8_t {
+    kEq,
+    kNe,
+    kLt,
+    kGt,
+    kLe,
+    kGe,
+};
+
+struct Instruction {
+    Opcode op;
+    Condition cond = Condition::kEq;
+    VReg dst = kNoVReg;
+    VReg a = kNoVReg;
+    VReg b = kNoVReg;
+    VReg c = kNoVReg;
+    int64_t imm = 0;
+    int64_t constant = 0;
+};
+
+struct Function {
+    std::vector<Instruction> code;
+    std::vector<std::string> globals;
+    std::vector<std::string> texts;
+    size_t num_vregs = 0;
+};
+
+// The condition that holds exactly when `cond` does not.
+Condition Negate(Condition cond);
+// The condition that holds for (b, a) exactly when `cond` holds for (a, b).
+Condition Swap(Condition cond);
+// The condition of an A_EQ..A_GE node.
+Condition ConditionOf(ASTNode::Type op);
+// Whether the instruction calls out of main and so clobbers the caller-saved registers.
+bool IsCall(const Instruction &in);
+// Whether control can continue with the next instruction.
+bool FallsThrough(const Instruction &in);
+}  // namespace ir
+}  // namespace my_cpp
+// A listing of the IR, as --dump-ir prints it.
+std::ostream &operator<<(std::ostream &os, const my_cpp::ir::Function &function);
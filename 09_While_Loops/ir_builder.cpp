@@ -0,0 +1,147 @@
+#include "ir_builder.hpp"
+
+#include "gen_impl.hpp"
+// Standard includes
+// C++ Standard
+#include <utility>
+// C Standard
+
+namespace my_cpp {
+IRBuilder::IRBuilder(CompilationContext &context, std::ostream &os)
+    : BasicCodeGenerator(context, os) {
+}
+
+ir::Function IRBuilder::TakeFunction() {
+    global_index_.clear();
+    return std::move(function_);
+}
+
+ir::VReg IRBuilder::vreg_new() {
+    return static_cast<ir::VReg>(function_.num_vregs++);
+}
+
+size_t IRBuilder::global(size_t id) {
+    if (id >= global_index_.size()) {
+        global_index_.resize(id + 1, kNoGlobal);
+    }
+    if (global_index_[id] == kNoGlobal) {
+        global_index_[id] = function_.globals.size();
+        function_.globals.emplace_back(context_.GetSymbolTable().GetName(id));
+    }
+    return global_index_[id];
+}
+
+ir::Instruction &IRBuilder::emit(ir::Opcode op) {
+    ir::Instruction in;
+    in.op = op;
+    return function_.code.emplace_back(in);
+}
+
+size_t IRBuilder::emit_binary(ir::Opcode op, size_t left_reg, size_t right_reg) {
+    auto &in = emit(op);
+    in.a = static_cast<ir::VReg>(left_reg);
+    in.b = static_cast<ir::VReg>(right_reg);
+    in.dst = vreg_new();
+    return in.dst;
+}
+
+size_t IRBuilder::registers_alloc() {
+    return vreg_new();
+}
+
+void IRBuilder::codegen_printint(size_t reg) {
+    emit(ir::Opcode::kPrint).a = static_cast<ir::VReg>(reg);
+}
+
+void IRBuilder::codegen_text(std::string_view text) {
+    emit(ir::Opcode::kText).imm = static_cast<int64_t>(function_.texts.size());
+    function_.texts.emplace_back(text);
+}
+
+size_t IRBuilder::codegen_add(size_t left_reg, size_t right_reg) {
+    return emit_binary(ir::Opcode::kAdd, left_reg, right_reg);
+}
+
+size_t IRBuilder::codegen_sub(size_t left_reg, size_t right_reg) {
+    return emit_binary(ir::Opcode::kSub, left_reg, right_reg);
+}
+
+size_t IRBuilder::codegen_mul(size_t left_reg, size_t right_reg) {
+    return emit_binary(ir::Opcode::kMul, left_reg, right_reg);
+}
+
+size_t IRBuilder::codegen_div(size_t left_reg, size_t right_reg) {
+    return emit_binary(ir::Opcode::kDiv, left_reg, right_reg);
+}
+
+size_t IRBuilder::codegen_load_int(int64_t value) {
+    auto &in = emit(ir::Opcode::kConst);
+    in.dst = vreg_new();
+    in.imm = value;
+    return in.dst;
+}
+
+size_t IRBuilder::codegen_load_gblob(size_t id) {
+    const size_t kGlobal = global(id);
+    auto &in = emit(ir::Opcode::kLoadGlobal);
+    in.dst = vreg_new();
+    in.imm = static_cast<int64_t>(kGlobal);
+    return in.dst;
+}
+
+size_t IRBuilder::codegen_store_gblob(size_t reg, size_t id) {
+    const size_t kGlobal = global(id);
+    auto &in = emit(ir::Opcode::kStoreGlobal);
+    in.a = static_cast<ir::VReg>(reg);
+    in.imm = static_cast<int64_t>(kGlobal);
+    return reg;
+}
+
+size_t IRBuilder::codegen_load_local(size_t frame_offset) {
+    auto &in = emit(ir::Opcode::kLoadLocal);
+    in.dst = vreg_new();
+    in.imm = static_cast<int64_t>(frame_offset);
+    return in.dst;
+}
+
+size_t IRBuilder::codegen_store_local(size_t reg, size_t frame_offset) {
+    auto &in = emit(ir::Opcode::kStoreLocal);
+    in.a = static_cast<ir::VReg>(reg);
+    in.imm = static_cast<int64_t>(frame_offset);
+    return reg;
+}
+
+void IRBuilder::codegen_label(size_t label) {
+    emit(ir::Opcode::kLabel).imm = static_cast<int64_t>(label);
+}
+
+void IRBuilder::codegen_jump(size_t label) {
+    emit(ir::Opcode::kJump).imm = static_cast<int64_t>(label);
+}
+
+// The traversal jumps to `jump_reg` when the condition does not hold.
+size_t IRBuilder::codegen_compare_and_jump(
+        ASTNode::Type op,
+        size_t left_reg,
+        size_t right_reg,
+        size_t jump_reg) {
+    auto &in = emit(ir::Opcode::kBranch);
+    in.cond = ir::Negate(ir::ConditionOf(op));
+    in.a = static_cast<ir::VReg>(left_reg);
+    in.b = static_cast<ir::VReg>(right_reg);
+    in.imm = static_cast<int64_t>(jump_reg);
+    return kNoRegister;
+}
+
+size_t IRBuilder::codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg) {
+    const size_t kDst = emit_binary(ir::Opcode::kCompare, left_reg, right_reg);
+    function_.code.back().cond = ir::ConditionOf(op);
+    return kDst;
+}
+
+void IRBuilder::codegen_symbol(size_t id) {
+    emit(ir::Opcode::kGlobal).imm = static_cast<int64_t>(global(id));
+}
+
+template class BasicCodeGenerator<IRBuilder>;
+}  // namespace my_cpp
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "gen.hpp"
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+#include <string_view>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Lowers the AST to ir::Function through the shared traversal. Every value the traversal asks a
+// register for gets a fresh virtual register, so nothing is ever freed or reused here; the
+// allocator decides later which of them share a machine register.
+class IRBuilder : public BasicCodeGenerator<IRBuilder> {
+public:
+    IRBuilder(CompilationContext &context, std::ostream &os);
+    ~IRBuilder() = default;
+    // Hands over the code generated so far.
+    ir::Function TakeFunction();
+
+private:
+    friend class BasicCodeGenerator<IRBuilder>;
+
+    static constexpr size_t kNoGlobal = static_cast<size_t>(-1);
+
+    ir::Function function_;
+    // Index in function_.globals of each symbol id, or kNoGlobal before its first use.
+    std::vector<size_t> global_index_;
+
+    ir::VReg vreg_new();
+    size_t global(size_t id);
+    ir::Instruction &emit(ir::Opcode op);
+    size_t emit_binary(ir::Opcode op, size_t left_reg, size_t right_reg);
+
+    void registers_free_all() {
+    }
+    size_t registers_alloc();
+    void register_free(size_t reg) {
+    }
+
+    void codegen_printint(size_t reg);
+    void codegen_text(std::string_view text);
+
+    size_t codegen_add(size_t left_reg, size_t right_reg);
+    size_t codegen_sub(size_t left_reg, size_t right_reg);
+    size_t codegen_mul(size_t left_reg, size_t right_reg);
+    size_t codegen_div(size_t left_reg, size_t right_reg);
+    size_t codegen_load_int(int64_t value);
+    size_t codegen_load_gblob(size_t id);
+    size_t codegen_store_gblob(size_t reg, size_t id);
+    size_t codegen_load_local(size_t frame_offset);
+    size_t codegen_store_local(size_t reg, size_t frame_offset);
+    void codegen_label(size_t label);
+    void codegen_jump(size_t label);
+
+    size_t codegen_compare_and_jump(
+            ASTNode::Type op,
+            size_t left_reg,
+            size_t right_reg,
+            size_t jump_reg);
+    size_t codegen_compare_and_set(ASTNode::Type op, size_t left_reg, size_t right_reg);
+
+    void codegen_symbol(size_t id);
+};
+
+extern template class BasicCodeGenerator<IRBuilder>;
+}  // namespace my_cpp
@@ -1,38 +1,232 @@
 // Project includes
+#include "closure.hpp"
+#include "context.hpp"
 #include "parser.hpp"
+#include "gen_bytecode.hpp"
+#include "gen_jit.hpp"
 #include "gen_x86.hpp"
+#include "interp.hpp"
+#include "optimize.hpp"
+#include "peval.hpp"
+#include "tiered.hpp"
+#include "vm.hpp"
 // Standard includes
 // C++ Standard
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 // C Standard
+#include <cstdlib>
+
+namespace {
+enum class Mode {
+    kCompile,  // Write x86-64 assembly
+    kRun,      // Interpret the program directly
+    kVm,       // Compile to bytecode and run it on the virtual machine
+    kClosure,  // Compile to specialised closures and run them
+    kJit,      // Compile to machine code in memory and run it
+    kTiered,   // Interpret, compiling hot loops to machine code
+};
+
+struct Options {
+    Mode mode = Mode::kCompile;
+    bool optimize = true;  // -O0 turns the AST and SSA optimizations off
+    bool licm = true;      // --no-licm keeps loop-invariant expressions in their loops
+    bool peval = false;    // --peval runs what it can of the program while compiling
+    bool stats = false;    // --stats prints the compiler's statistics
+    bool dump_ir = false;  // --dump-ir prints the IR the x86 backend allocates registers for
+    size_t fuel = my_cpp::PartialEvaluator::kDefaultFuel;
+    size_t tier_threshold = my_cpp::TieredInterpreter::kDefaultThreshold;
+    std::vector<std::string> inputs;
+};
+
+struct Job {
+    std::string input;
+    std::string output;
+    bool ok = false;
+    std::vector<std::string> diagnostics;
+    std::vector<std::pair<std::string, size_t>> statistics;
+    std::string ir;
+};
 
 void usage(const char *program_name) {
-    std::cerr << "Usage: " << program_name << " <input_file>" << std::endl;
+    std::cerr << "Usage: " << program_name
+              << " [-O0] [--no-licm] [--stats] [--dump-ir] [--peval [--fuel <loop_iterations>]]"
+                 " [--run | --vm | --closure | --jit | --tiered [--tier-threshold <back_edges>]]"
+                 " <input_file> [<input_file> ...]"
+              << std::endl;
 }
 
+bool parse_options(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string kArg = argv[i];
+        if (kArg == "--run") {
+            options.mode = Mode::kRun;
+        } else if (kArg == "--vm") {
+            options.mode = Mode::kVm;
+        } else if (kArg == "--closure") {
+            options.mode = Mode::kClosure;
+        } else if (kArg == "--jit") {
+            options.mode = Mode::kJit;
+        } else if (kArg == "--tiered") {
+            options.mode = Mode::kTiered;
+        } else if (kArg == "-O0") {
+            options.optimize = false;
+        } else if (kArg == "--no-licm") {
+            options.licm = false;
+        } else if (kArg == "--stats") {
+            options.stats = true;
+        } else if (kArg == "--dump-ir") {
+            options.dump_ir = true;
+        } else if (kArg == "--peval") {
+            options.peval = true;
+        } else if (kArg == "--fuel" && i + 1 < argc) {
+            options.fuel = std::strtoull(argv[++i], nullptr, 10);
+        } else if (kArg == "--tier-threshold" && i + 1 < argc) {
+            options.tier_threshold = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!kArg.empty() && kArg[0] == '-') {
+            return false;
+        } else {
+            options.inputs.push_back(kArg);
+        }
+    }
+    return !options.inputs.empty();
+}
+
+// Compiles one file with its own CompilationContext; nothing here touches shared state.
+void compile(Job &job, const Options &options) {
+    my_cpp::CompilationContext context;
+    try {
+        std::ifstream input(job.input);
+        if (!input) {
+            throw std::runtime_error("Failed to open input file");
+        }
+        auto scanner = my_cpp::utility::MakeScanner(input);
+        scanner->Scan();
+        auto parser = std::make_unique<my_cpp::Parser>(std::move(scanner), context);
+        auto ast = parser->Parse();
+        if (options.optimize) {
+            ast = my_cpp::ConstantFolder().Run(ast);
+            my_cpp::DeadStoreEliminator eliminator;
+            ast = eliminator.Run(ast);
+            context.AddStatistic("dse.stores", eliminator.GetStatistics().stores);
+            context.AddStatistic("dse.declarations", eliminator.GetStatistics().declarations);
+            if (options.licm) {
+                my_cpp::LoopInvariantMover mover(context.GetSymbolTable());
+                ast = mover.Run(ast);
+                context.AddStatistic("licm.hoisted", mover.GetHoisted());
+            }
+        }
+
+        switch (options.mode) {
+        case Mode::kCompile: {
+            std::ofstream output(job.output);
+            if (!output) {
+                throw std::runtime_error("Failed to open output file");
+            }
+            // Gathered per job and printed in input order once every job is done.
+            std::ostringstream ir;
+            my_cpp::CodeGeneratorX86 codegen(
+                    context, output, options.optimize, options.dump_ir ? &ir : nullptr);
+            if (options.peval) {
+                my_cpp::PartialEvaluator evaluator(context, options.fuel);
+                codegen.GenerateResidual(evaluator.Evaluate(*ast));
+            } else {
+                codegen.GenerateCode(*ast);
+            }
+            job.ir = ir.str();
+        } break;
+        case Mode::kRun: {
+            my_cpp::Interpreter interpreter(context, std::cout);
+            interpreter.Run(*ast);
+        } break;
+        case Mode::kVm: {
+            std::ostream no_listing(nullptr);
+            my_cpp::CodeGeneratorBytecode codegen(context, no_listing);
+            codegen.GenerateCode(*ast);
+            my_cpp::VirtualMachine vm(std::cout);
+            vm.Run(codegen.GetBytecode());
+        } break;
+        case Mode::kClosure: {
+            my_cpp::ClosureProgram program(context, *ast, std::cout);
+            program.Run();
+        } break;
+        case Mode::kJit: {
+            std::ostream no_listing(nullptr);
+            my_cpp::OutputBuffer output(std::cout);
+            my_cpp::CodeGeneratorJIT codegen(context, no_listing, output);
+            codegen.GenerateCode(*ast);
+            codegen.Run();
+        } break;
+        case Mode::kTiered: {
+            my_cpp::TieredInterpreter interpreter(context, std::cout, options.tier_threshold);
+            interpreter.Run(*ast);
+            context.AddStatistic("tiered.loops", interpreter.GetCompiledLoops());
+        } break;
+        }
+        job.ok = true;
+    } catch (const std::exception &e) {
+        context.AddDiagnostic(e.what());
+    }
+    job.diagnostics = context.GetDiagnostics();
+    job.statistics = context.GetStatistics();
+}
+}  // namespace
+
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
         usage(argv[0]);
         return 1;
     }
-    std::ifstream input(argv[1]);
-    if (!input) {
-        std::cerr << "Failed to open input file" << std::endl;
-        return 1;
+    // A single input keeps the historical out.s; several inputs each get <input>.s.
+    std::vector<Job> jobs(options.inputs.size());
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        jobs[i].input = options.inputs[i];
+        jobs[i].output = jobs.size() == 1 ? "out.s" : jobs[i].input + ".s";
     }
-    auto scanner = my_cpp::utility::MakeScanner(input);
-    scanner->Scan();
-    auto parser = std::make_unique<my_cpp::Parser>(std::move(scanner));
-    auto ast = parser->Parse();
-
-    std::ofstream output("out.s");
-    if (!output) {
-        std::cerr << "Failed to open output file" << std::endl;
-        return 1;
+
+    std::atomic<size_t> next_job{0};
+    auto worker = [&jobs, &next_job, &options]() {
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+            compile(jobs[i], options);
+        }
+    };
+    // Programs that run write to stdout, so they run one after another.
+    const size_t kWorkers = options.mode == Mode::kCompile
+            ? std::min<size_t>(jobs.size(), std::max(1u, std::thread::hardware_concurrency()))
+            : 1;
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < kWorkers; ++i) {
+        pool.emplace_back(worker);
     }
-    my_cpp::CodeGeneratorX86 codegen(output);
-    codegen.GenerateCode(ast);
-    return 0;
-}
\ No newline at end of file
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    int result = 0;
+    for (const auto &job : jobs) {
+        std::cout << job.ir;
+        for (const auto &message : job.diagnostics) {
+            std::cerr << job.input << ": " << message << std::endl;
+        }
+        if (options.stats) {
+            for (const auto &[name, value] : job.statistics) {
+                std::cerr << job.input << ": " << name << " = " << value << std::endl;
+            }
+        }
+        if (!job.ok) {
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,540 @@
+#include "optimize.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+namespace {
+bool is_constant(const ASTNode &node, int value) {
+    return node.GetOp() == ASTNode::Type::A_INTLIT && node.GetValue<int>() == value;
+}
+
+std::shared_ptr<ASTNode> make_constant(int value) {
+    auto leaf_value = std::make_unique<Value>();
+    leaf_value->int_value_ = value;
+    return ASTNode::MakeAstLeaf(ASTNode::Type::A_INTLIT, std::move(leaf_value));
+}
+
+// The value of `op` applied to two constants, if it is known at compile time and fits an int.
+std::optional<int> evaluate(ASTNode::Type op, int64_t left, int64_t right) {
+    int64_t result = 0;
+    switch (op) {
+    case ASTNode::Type::A_ADD:
+        result = arith::Add(left, right);
+        break;
+    case ASTNode::Type::A_SUBTRACT:
+        result = arith::Sub(left, right);
+        break;
+    case ASTNode::Type::A_MULTIPLY:
+        result = arith::Mul(left, right);
+        break;
+    case ASTNode::Type::A_DIVIDE:
+        if (arith::DivFaults(left, right)) {
+            return std::nullopt;
+        }
+        result = left / right;
+        break;
+    case ASTNode::Type::A_EQ:
+        return left == right;
+    case ASTNode::Type::A_NE:
+        return left != right;
+    case ASTNode::Type::A_LT:
+        return left < right;
+    case ASTNode::Type::A_GT:
+        return left > right;
+    case ASTNode::Type::A_LE:
+        return left <= right;
+    case ASTNode::Type::A_GE:
+        return left >= right;
+    default:
+        return std::nullopt;
+    }
+    if (result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max()) {
+        return std::nullopt;
+    }
+    return static_cast<int>(result);
+}
+
+// Whether evaluating the expression may stop the program with a division fault.
+bool may_fault(const ASTNode &node) {
+    if (node.GetOp() == ASTNode::Type::A_DIVIDE) {
+        const auto &divisor = *node.GetRight();
+        if (divisor.GetOp() != ASTNode::Type::A_INTLIT || divisor.GetValue<int>() == 0
+            || divisor.GetValue<int>() == -1) {
+            return true;
+        }
+    }
+    return (node.GetLeft() != nullptr && may_fault(*node.GetLeft()))
+            || (node.GetRight() != nullptr && may_fault(*node.GetRight()));
+}
+
+// Structural equality of two expressions; both always yield the same value.
+bool same_expr(const ASTNode &a, const ASTNode &b) {
+    if (a.GetOp() != b.GetOp()) {
+        return false;
+    }
+    switch (a.GetOp()) {
+    case ASTNode::Type::A_INTLIT:
+        return a.GetValue<int>() == b.GetValue<int>();
+    case ASTNode::Type::A_IDENT:
+        return a.GetValue<size_t>() == b.GetValue<size_t>();
+    default:
+        return same_expr(*a.GetLeft(), *b.GetLeft()) && same_expr(*a.GetRight(), *b.GetRight());
+    }
+}
+
+// Two statements in sequence, either of which may be nullptr for nothing.
+std::shared_ptr<ASTNode> glue(std::shared_ptr<ASTNode> left, std::shared_ptr<ASTNode> right) {
+    if (left == nullptr) {
+        return right;
+    }
+    if (right == nullptr) {
+        return left;
+    }
+    return ASTNode::MakeAstNode(ASTNode::Type::A_GLUE, std::move(left), nullptr, std::move(right));
+}
+
+// Adds the symbol ids of the variables the subtree reads, and also of those it assigns if
+// `assigned` is set.
+void add_variables(const ASTNode *node, bool assigned, std::unordered_set<size_t> &ids) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->GetOp() == ASTNode::Type::A_IDENT
+        || (assigned && node->GetOp() == ASTNode::Type::A_LVIDENT)) {
+        ids.insert(node->GetValue<size_t>());
+        return;
+    }
+    add_variables(node->GetLeft().get(), assigned, ids);
+    add_variables(node->GetMiddle().get(), assigned, ids);
+    add_variables(node->GetRight().get(), assigned, ids);
+}
+
+// Adds the symbol ids of the variables the subtree assigns, declarations included since they set
+// their variable to 0.
+void add_assigned(const ASTNode *node, std::unordered_set<size_t> &ids) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->GetOp() == ASTNode::Type::A_LVIDENT || node->GetOp() == ASTNode::Type::A_VAR_DECL) {
+        ids.insert(node->GetValue<size_t>());
+        return;
+    }
+    add_assigned(node->GetLeft().get(), ids);
+    add_assigned(node->GetMiddle().get(), ids);
+    add_assigned(node->GetRight().get(), ids);
+}
+
+// Whether the expression reads none of `assigned`.
+bool invariant(const ASTNode &node, const std::unordered_set<size_t> &assigned) {
+    if (node.GetOp() == ASTNode::Type::A_IDENT) {
+        return assigned.count(node.GetValue<size_t>()) == 0;
+    }
+    return (node.GetLeft() == nullptr || invariant(*node.GetLeft(), assigned))
+            && (node.GetRight() == nullptr || invariant(*node.GetRight(), assigned));
+}
+
+std::shared_ptr<ASTNode> make_variable(ASTNode::Type op, size_t id) {
+    auto leaf_value = std::make_unique<Value>();
+    leaf_value->sym_id = id;
+    return ASTNode::MakeAstLeaf(op, std::move(leaf_value));
+}
+}  // namespace
+
+std::shared_ptr<ASTNode> ConstantFolder::Run(const std::shared_ptr<ASTNode> &root) {
+    auto folded = fold_stmt(root);
+    if (folded == nullptr) {
+        return ASTNode::MakeAstNode(ASTNode::Type::A_GLUE, nullptr, nullptr, nullptr);
+    }
+    return folded;
+}
+
+// Returns nullptr for a statement that has nothing left to do.
+std::shared_ptr<ASTNode> ConstantFolder::fold_stmt(const std::shared_ptr<ASTNode> &node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->GetOp()) {
+    case ASTNode::Type::A_GLUE: {
+        auto left = fold_stmt(node->GetLeft());
+        return glue(std::move(left), fold_stmt(node->GetRight()));
+    }
+    case ASTNode::Type::A_ASSIGN:
+        return ASTNode::MakeAstNode(
+                ASTNode::Type::A_ASSIGN, fold_expr(node->GetLeft()), nullptr, node->GetRight());
+    case ASTNode::Type::A_PRINT:
+        return ASTNode::MakeAstUnary(ASTNode::Type::A_PRINT, fold_expr(node->GetLeft()));
+    case ASTNode::Type::A_IF: {
+        auto cond = fold_expr(node->GetLeft());
+        if (cond->GetOp() == ASTNode::Type::A_INTLIT) {
+            return fold_stmt(cond->GetValue<int>() != 0 ? node->GetMiddle() : node->GetRight());
+        }
+        return ASTNode::MakeAstNode(
+                ASTNode::Type::A_IF, cond, fold_stmt(node->GetMiddle()),
+                fold_stmt(node->GetRight()));
+    }
+    case ASTNode::Type::A_WHILE: {
+        auto cond = fold_expr(node->GetLeft());
+        if (is_constant(*cond, 0)) {
+            return nullptr;
+        }
+        // Code generation wants a comparison here, so an always-true one is kept as written.
+        if (cond->GetOp() == ASTNode::Type::A_INTLIT) {
+            cond = node->GetLeft();
+        }
+        return ASTNode::MakeAstNode(
+                ASTNode::Type::A_WHILE, cond, nullptr, fold_stmt(node->GetRight()));
+    }
+    default:
+        return node;
+    }
+}
+
+std::shared_ptr<ASTNode> ConstantFolder::fold_expr(const std::shared_ptr<ASTNode> &node) {
+    if (node->GetLeft() == nullptr || node->GetRight() == nullptr) {
+        return node;
+    }
+    auto left = fold_expr(node->GetLeft());
+    auto right = fold_expr(node->GetRight());
+    if (left->GetOp() == ASTNode::Type::A_INTLIT && right->GetOp() == ASTNode::Type::A_INTLIT) {
+        if (auto value = evaluate(node->GetOp(), left->GetValue<int>(), right->GetValue<int>())) {
+            return make_constant(*value);
+        }
+    }
+    if (auto simplified = simplify(node->GetOp(), left, right)) {
+        return simplified;
+    }
+    if (left == node->GetLeft() && right == node->GetRight()) {
+        return node;
+    }
+    return ASTNode::MakeAstNode(node->GetOp(), left, nullptr, right);
+}
+
+// Algebraic identities; nullptr when none applies.
+std::shared_ptr<ASTNode> ConstantFolder::simplify(
+        ASTNode::Type op,
+        const std::shared_ptr<ASTNode> &left,
+        const std::shared_ptr<ASTNode> &right) {
+    switch (op) {
+    case ASTNode::Type::A_ADD:
+        if (is_constant(*right, 0)) {
+            return left;
+        }
+        if (is_constant(*left, 0)) {
+            return right;
+        }
+        break;
+    case ASTNode::Type::A_SUBTRACT:
+        if (is_constant(*right, 0)) {
+            return left;
+        }
+        if (same_expr(*left, *right) && !may_fault(*left)) {
+            return make_constant(0);
+        }
+        break;
+    case ASTNode::Type::A_MULTIPLY:
+        if (is_constant(*right, 1)) {
+            return left;
+        }
+        if (is_constant(*left, 1)) {
+            return right;
+        }
+        if ((is_constant(*right, 0) && !may_fault(*left))
+            || (is_constant(*left, 0) && !may_fault(*right))) {
+            return make_constant(0);
+        }
+        break;
+    case ASTNode::Type::A_DIVIDE:
+        if (is_constant(*right, 1)) {
+            return left;
+        }
+        break;
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<ASTNode> DeadStoreEliminator::Run(const std::shared_ptr<ASTNode> &root) {
+    statistics_ = {};
+    // Nothing reads the variables once the program ends.
+    Live live;
+    auto stored = remove_stores(root, live);
+    std::unordered_set<size_t> referenced;
+    add_variables(stored.get(), true, referenced);
+    auto declared = remove_declarations(stored, referenced);
+    if (declared == nullptr) {
+        return ASTNode::MakeAstNode(ASTNode::Type::A_GLUE, nullptr, nullptr, nullptr);
+    }
+    return declared;
+}
+
+const DeadStoreEliminator::Statistics &DeadStoreEliminator::GetStatistics() const {
+    return statistics_;
+}
+
+// Walks the statements backward: `live` holds what is live after the node on entry and what is
+// live before it on return. Returns nullptr for a statement that has nothing left to do.
+std::shared_ptr<ASTNode> DeadStoreEliminator::remove_stores(
+        const std::shared_ptr<ASTNode> &node,
+        Live &live) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->GetOp()) {
+    case ASTNode::Type::A_GLUE: {
+        auto right = remove_stores(node->GetRight(), live);
+        auto left = remove_stores(node->GetLeft(), live);
+        if (left == node->GetLeft() && right == node->GetRight()) {
+            return node;
+        }
+        return glue(std::move(left), std::move(right));
+    }
+    case ASTNode::Type::A_ASSIGN: {
+        const size_t kId = node->GetRight()->GetValue<size_t>();
+        if (live.erase(kId) == 0 && !may_fault(*node->GetLeft())) {
+            ++statistics_.stores;
+            return nullptr;
+        }
+        add_variables(node->GetLeft().get(), false, live);
+        return node;
+    }
+    case ASTNode::Type::A_PRINT:
+        add_variables(node->GetLeft().get(), false, live);
+        return node;
+    case ASTNode::Type::A_IF: {
+        Live else_live = live;
+        auto else_arm = remove_stores(node->GetRight(), else_live);
+        auto then_arm = remove_stores(node->GetMiddle(), live);
+        live.insert(else_live.begin(), else_live.end());
+        if (then_arm == nullptr && else_arm == nullptr && !may_fault(*node->GetLeft())) {
+            return nullptr;
+        }
+        add_variables(node->GetLeft().get(), false, live);
+        if (then_arm == node->GetMiddle() && else_arm == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_IF, node->GetLeft(), then_arm, else_arm);
+    }
+    case ASTNode::Type::A_WHILE: {
+        // What is live at the loop head is also live after the body and after the loop.
+        add_variables(node.get(), false, live);
+        Live body_live = live;
+        auto body = remove_stores(node->GetRight(), body_live);
+        if (body == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_WHILE, node->GetLeft(), nullptr, body);
+    }
+    default:
+        return node;
+    }
+}
+
+std::shared_ptr<ASTNode> DeadStoreEliminator::remove_declarations(
+        const std::shared_ptr<ASTNode> &node,
+        const std::unordered_set<size_t> &referenced) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->GetOp()) {
+    case ASTNode::Type::A_GLUE: {
+        auto left = remove_declarations(node->GetLeft(), referenced);
+        auto right = remove_declarations(node->GetRight(), referenced);
+        if (left == node->GetLeft() && right == node->GetRight()) {
+            return node;
+        }
+        return glue(std::move(left), std::move(right));
+    }
+    case ASTNode::Type::A_VAR_DECL:
+        if (referenced.count(node->GetValue<size_t>()) == 0) {
+            ++statistics_.declarations;
+            return nullptr;
+        }
+        return node;
+    case ASTNode::Type::A_IF: {
+        auto then_arm = remove_declarations(node->GetMiddle(), referenced);
+        auto else_arm = remove_declarations(node->GetRight(), referenced);
+        if (then_arm == node->GetMiddle() && else_arm == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_IF, node->GetLeft(), then_arm, else_arm);
+    }
+    case ASTNode::Type::A_WHILE: {
+        auto body = remove_declarations(node->GetRight(), referenced);
+        if (body == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_WHILE, node->GetLeft(), nullptr, body);
+    }
+    default:
+        return node;
+    }
+}
+
+LoopInvariantMover::LoopInvariantMover(SymbolTable &symbols) : symbols_(symbols) {
+}
+
+std::shared_ptr<ASTNode> LoopInvariantMover::Run(const std::shared_ptr<ASTNode> &root) {
+    hoisted_ = 0;
+    auto moved = move_stmt(root);
+    if (moved == nullptr) {
+        return ASTNode::MakeAstNode(ASTNode::Type::A_GLUE, nullptr, nullptr, nullptr);
+    }
+    return moved;
+}
+
+size_t LoopInvariantMover::GetHoisted() const {
+    return hoisted_;
+}
+
+std::shared_ptr<ASTNode> LoopInvariantMover::move_stmt(const std::shared_ptr<ASTNode> &node) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->GetOp()) {
+    case ASTNode::Type::A_GLUE: {
+        auto left = move_stmt(node->GetLeft());
+        auto right = move_stmt(node->GetRight());
+        if (left == node->GetLeft() && right == node->GetRight()) {
+            return node;
+        }
+        return glue(std::move(left), std::move(right));
+    }
+    case ASTNode::Type::A_IF: {
+        auto then_arm = move_stmt(node->GetMiddle());
+        auto else_arm = move_stmt(node->GetRight());
+        if (then_arm == node->GetMiddle() && else_arm == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_IF, node->GetLeft(), then_arm, else_arm);
+    }
+    case ASTNode::Type::A_WHILE:
+        return move_loop(node);
+    default:
+        return node;
+    }
+}
+
+// The hoisted expressions become assignments to their temporaries, glued in front of the loop.
+std::shared_ptr<ASTNode> LoopInvariantMover::move_loop(const std::shared_ptr<ASTNode> &loop) {
+    auto body = move_stmt(loop->GetRight());
+    Assigned assigned;
+    add_assigned(body.get(), assigned);
+    std::vector<Hoisted> hoisted;
+    auto cond = replace_operands(loop->GetLeft(), assigned, hoisted);
+    body = replace_stmt(body, assigned, hoisted);
+    if (cond == loop->GetLeft() && body == loop->GetRight()) {
+        return loop;
+    }
+    std::shared_ptr<ASTNode> moved;
+    for (const auto &[expr, id] : hoisted) {
+        moved = glue(
+                std::move(moved),
+                ASTNode::MakeAstNode(
+                        ASTNode::Type::A_ASSIGN, expr, nullptr,
+                        make_variable(ASTNode::Type::A_LVIDENT, id)));
+    }
+    hoisted_ += hoisted.size();
+    return glue(
+            std::move(moved), ASTNode::MakeAstNode(ASTNode::Type::A_WHILE, cond, nullptr, body));
+}
+
+std::shared_ptr<ASTNode> LoopInvariantMover::replace_stmt(
+        const std::shared_ptr<ASTNode> &node,
+        const Assigned &assigned,
+        std::vector<Hoisted> &hoisted) {
+    if (node == nullptr) {
+        return nullptr;
+    }
+    switch (node->GetOp()) {
+    case ASTNode::Type::A_GLUE: {
+        auto left = replace_stmt(node->GetLeft(), assigned, hoisted);
+        auto right = replace_stmt(node->GetRight(), assigned, hoisted);
+        if (left == node->GetLeft() && right == node->GetRight()) {
+            return node;
+        }
+        return glue(std::move(left), std::move(right));
+    }
+    case ASTNode::Type::A_ASSIGN: {
+        auto value = replace_expr(node->GetLeft(), assigned, hoisted);
+        if (value == node->GetLeft()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_ASSIGN, value, nullptr, node->GetRight());
+    }
+    case ASTNode::Type::A_PRINT: {
+        auto value = replace_expr(node->GetLeft(), assigned, hoisted);
+        if (value == node->GetLeft()) {
+            return node;
+        }
+        return ASTNode::MakeAstUnary(ASTNode::Type::A_PRINT, value);
+    }
+    case ASTNode::Type::A_IF: {
+        auto cond = replace_operands(node->GetLeft(), assigned, hoisted);
+        auto then_arm = replace_stmt(node->GetMiddle(), assigned, hoisted);
+        auto else_arm = replace_stmt(node->GetRight(), assigned, hoisted);
+        if (cond == node->GetLeft() && then_arm == node->GetMiddle()
+            && else_arm == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_IF, cond, then_arm, else_arm);
+    }
+    case ASTNode::Type::A_WHILE: {
+        auto cond = replace_operands(node->GetLeft(), assigned, hoisted);
+        auto body = replace_stmt(node->GetRight(), assigned, hoisted);
+        if (cond == node->GetLeft() && body == node->GetRight()) {
+            return node;
+        }
+        return ASTNode::MakeAstNode(ASTNode::Type::A_WHILE, cond, nullptr, body);
+    }
+    default:
+        return node;
+    }
+}
+
+// For a condition, whose comparison code generation needs to see.
+std::shared_ptr<ASTNode> LoopInvariantMover::replace_operands(
+        const std::shared_ptr<ASTNode> &node,
+        const Assigned &assigned,
+        std::vector<Hoisted> &hoisted) {
+    if (node->GetLeft() == nullptr || node->GetRight() == nullptr) {
+        return node;
+    }
+    auto left = replace_expr(node->GetLeft(), assigned, hoisted);
+    auto right = replace_expr(node->GetRight(), assigned, hoisted);
+    if (left == node->GetLeft() && right == node->GetRight()) {
+        return node;
+    }
+    return ASTNode::MakeAstNode(node->GetOp(), left, nullptr, right);
+}
+
+std::shared_ptr<ASTNode> LoopInvariantMover::replace_expr(
+        const std::shared_ptr<ASTNode> &node,
+        const Assigned &assigned,
+        std::vector<Hoisted> &hoisted) {
+    if (node->GetLeft() == nullptr || node->GetRight() == nullptr) {
+        return node;
+    }
+    if (!invariant(*node, assigned) || may_fault(*node)) {
+        return replace_operands(node, assigned, hoisted);
+    }
+    for (const auto &[expr, id] : hoisted) {
+        if (same_expr(*expr, *node)) {
+            return make_variable(ASTNode::Type::A_IDENT, id);
+        }
+    }
+    const size_t kId = symbols_.AddTemporary("licm." + std::to_string(hoisted_ + hoisted.size()));
+    hoisted.push_back({node, kId});
+    return make_variable(ASTNode::Type::A_IDENT, kId);
+}
+}  // namespace my_cpp
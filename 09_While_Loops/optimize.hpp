@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ast.hpp"
+#include "symbols.hpp"
+// Standard includes
+// C++ Standard
+#include <memory>
+#include <unordered_set>
+#include <vector>
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+// Rewrites the tree between parsing and code generation. Constant operations are folded as long
+// as the result fits the int of an A_INTLIT, and x+0, x-0, x*1, x/1, x*0 and x-x are simplified
+// unless doing so would drop a division that can fault at run time. if/while statements whose
+// condition is constant lose their dead branch; a loop that never runs disappears.
+class ConstantFolder {
+public:
+    // Nodes are shared with the input tree where nothing changed.
+    std::shared_ptr<ASTNode> Run(const std::shared_ptr<ASTNode> &root);
+
+private:
+    std::shared_ptr<ASTNode> fold_stmt(const std::shared_ptr<ASTNode> &node);
+    std::shared_ptr<ASTNode> fold_expr(const std::shared_ptr<ASTNode> &node);
+    std::shared_ptr<ASTNode> simplify(
+            ASTNode::Type op,
+            const std::shared_ptr<ASTNode> &left,
+            const std::shared_ptr<ASTNode> &right);
+};
+
+// Removes assignments whose value no later statement can read, found by a backward liveness
+// pass over the tree, unless evaluating the value may fault; an if left with no arms goes too.
+// A loop takes every variable it reads as live throughout, which needs no fixpoint. Then the
+// declarations of variables nothing refers to any more are dropped, along with their storage.
+class DeadStoreEliminator {
+public:
+    struct Statistics {
+        size_t stores = 0;        // assignments removed
+        size_t declarations = 0;  // declarations removed
+    };
+
+    // Nodes are shared with the input tree where nothing changed.
+    std::shared_ptr<ASTNode> Run(const std::shared_ptr<ASTNode> &root);
+    const Statistics &GetStatistics() const;
+
+private:
+    // Symbol ids of the variables that may be read before they are written again.
+    using Live = std::unordered_set<size_t>;
+
+    Statistics statistics_;
+
+    std::shared_ptr<ASTNode> remove_stores(const std::shared_ptr<ASTNode> &node, Live &live);
+    std::shared_ptr<ASTNode> remove_declarations(
+            const std::shared_ptr<ASTNode> &node,
+            const std::unordered_set<size_t> &referenced);
+};
+
+// Hoists the expressions of a while loop that read no variable the loop assigns into temporaries
+// computed once in front of it. Only expressions with an operator are worth a temporary, and
+// only those that cannot fault, since they now run even when the loop body would not; a
+// condition keeps its comparison. Inner loops go first, so that what they hoist can move on out
+// of the loops around them.
+class LoopInvariantMover {
+public:
+    explicit LoopInvariantMover(SymbolTable &symbols);
+    // Nodes are shared with the input tree where nothing changed.
+    std::shared_ptr<ASTNode> Run(const std::shared_ptr<ASTNode> &root);
+    // The number of expressions hoisted, counted once per loop.
+    size_t GetHoisted() const;
+
+private:
+    // An expression hoisted out of the loop at hand, and the temporary holding its value.
+    struct Hoisted {
+        std::shared_ptr<ASTNode> expr;
+        size_t id;
+    };
+    // Symbol ids of the variables the loop at hand assigns.
+    using Assigned = std::unordered_set<size_t>;
+
+    SymbolTable &symbols_;
+    size_t hoisted_ = 0;
+
+    std::shared_ptr<ASTNode> move_stmt(const std::shared_ptr<ASTNode> &node);
+    std::shared_ptr<ASTNode> move_loop(const std::shared_ptr<ASTNode> &loop);
+    std::shared_ptr<ASTNode> replace_stmt(
+            const std::shared_ptr<ASTNode> &node,
+            const Assigned &assigned,
+            std::vector<Hoisted> &hoisted);
+    std::shared_ptr<ASTNode> replace_operands(
+            const std::shared_ptr<ASTNode> &node,
+            const Assigned &assigned,
+            std::vector<Hoisted> &hoisted);
+    std::shared_ptr<ASTNode> replace_expr(
+            const std::shared_ptr<ASTNode> &node,
+            const Assigned &assigned,
+            std::vector<Hoisted> &hoisted);
+};
+}  // namespace my_cpp
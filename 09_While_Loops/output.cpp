@@ -0,0 +1,43 @@
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <charconv>
+// C Standard
+
+namespace my_cpp {
+OutputBuffer::OutputBuffer(std::ostream &os) : os_(os) {
+}
+
+OutputBuffer::~OutputBuffer() {
+    Flush();
+}
+
+void OutputBuffer::PrintInt(int64_t value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), static_cast<int32_t>(value));
+    buffer_.append(digits, result.ptr);
+    buffer_.push_back('\n');
+    if (buffer_.size() >= kFlushThreshold) {
+        Flush();
+    }
+}
+
+void OutputBuffer::Flush() {
+    os_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
+
+TextBuffer::TextBuffer(std::ostream &os) : os_(os) {
+    buffer_.reserve(kHighWaterMark + kHighWaterMark / 4);
+}
+
+TextBuffer::~TextBuffer() {
+    Flush();
+}
+
+void TextBuffer::Flush() {
+    os_.write(buffer_.data(), buffer_.size());
+    os_.flush();
+    buffer_.clear();
+}
+}  // namespace my_cpp
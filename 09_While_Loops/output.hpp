@@ -0,0 +1,75 @@
+#pragma once
+
+// Standard includes
+// C++ Standard
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// Program output of the in-process engines. Printed values are gathered in memory and handed to
+// the stream in large chunks instead of one formatted write per print.
+class OutputBuffer {
+public:
+    OutputBuffer(std::ostream &os);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    // Same format as printint: the low 32 bits as a signed decimal, then a newline.
+    void PrintInt(int64_t value);
+    void Flush();
+
+private:
+    static constexpr size_t kFlushThreshold = 64 * 1024;
+
+    std::ostream &os_;
+    std::string buffer_;
+};
+
+// Generated text such as assembly. Pieces are appended to a growable buffer, integers are
+// formatted with std::to_chars, and the stream only sees a write when the buffer passes
+// kHighWaterMark or on Flush() and destruction; nothing is flushed per line.
+class TextBuffer {
+public:
+    TextBuffer(std::ostream &os);
+    ~TextBuffer();
+    TextBuffer(const TextBuffer &) = delete;
+    TextBuffer &operator=(const TextBuffer &) = delete;
+
+    TextBuffer &operator<<(std::string_view text) {
+        buffer_.append(text);
+        return check_high_water_mark();
+    }
+    TextBuffer &operator<<(char c) {
+        buffer_.push_back(c);
+        return check_high_water_mark();
+    }
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    TextBuffer &operator<<(T value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer_.append(digits, result.ptr);
+        return check_high_water_mark();
+    }
+    void Flush();
+
+private:
+    static constexpr size_t kHighWaterMark = 1024 * 1024;
+
+    std::ostream &os_;
+    std::string buffer_;
+
+    TextBuffer &check_high_water_mark() {
+        if (buffer_.size() >= kHighWaterMark) {
+            Flush();
+        }
+        return *this;
+    }
+};
+}  // namespace my_cpp
@@ -1,7 +1,6 @@
 #include "parser.hpp"
 
 #include "defs.hpp"
-#include "glob_vars.hpp"
 // Standard includes
 // C++ Standard
 #include <memory>
@@ -9,7 +8,8 @@
 // C Standard
 
 namespace my_cpp {
-Parser::Parser(std::unique_ptr<Scanner> scanner) : scanner_(std::move(scanner)) {
+Parser::Parser(std::unique_ptr<Scanner> scanner, CompilationContext &context)
+    : scanner_(std::move(scanner)), context_(context) {
 }
 
 std::shared_ptr<ASTNode> Parser::Parse() {
@@ -26,9 +26,9 @@ std::shared_ptr<ASTNode> Parser::primary() {
         result = ASTNode::MakeAstLeaf(ASTNode::Type::A_INTLIT, std::move(value));
     } break;
     case Token::Type::T_IDENT: {
-        auto global_symbol = find_global_symbol(token.GetText());
+        auto symbol = context_.GetSymbolTable().Find(token.GetText());
         auto value = std::make_unique<Value>();
-        value->sym_id = global_symbol;
+        value->sym_id = symbol;
         result = ASTNode::MakeAstLeaf(ASTNode::Type::A_IDENT, std::move(value));
     } break;
     default:
@@ -52,7 +52,6 @@ std::shared_ptr<ASTNode> Parser::bin_expr(const size_t prev_precedence) {
         scanner_->Scan();
         right = bin_expr(current_op_precedence);
         left = ASTNode::MakeAstNode(arith_op(current_op_type), left, nullptr, right);
-        auto token = scanner_->Curent().GetType();
         current_op_type = scanner_->Curent().GetType();
         if (current_op_type == Token::Type::T_SEMI || current_op_type == Token::Type::T_RPAREN) {
             break;
@@ -64,6 +63,11 @@ std::shared_ptr<ASTNode> Parser::bin_expr(const size_t prev_precedence) {
 
 std::shared_ptr<ASTNode> Parser::compound_stmts() {
     lbrace();
+    // The outermost block holds the globals; every nested block opens a scope for its locals.
+    const bool kNested = block_depth_++ > 0;
+    if (kNested) {
+        context_.GetSymbolTable().EnterScope();
+    }
     std::shared_ptr<ASTNode> left, tree;
     while (true) {
         switch (scanner_->Curent().GetType()) {
@@ -81,6 +85,10 @@ std::shared_ptr<ASTNode> Parser::compound_stmts() {
             break;
         case Token::Type::T_RBRACE:
             rbrace();
+            if (kNested) {
+                context_.GetSymbolTable().LeaveScope();
+            }
+            --block_depth_;
             return left;
         case Token::Type::T_WHILE:
             tree = while_stmt();
@@ -201,9 +209,9 @@ std::shared_ptr<ASTNode> Parser::print_stmt() {
 std::shared_ptr<ASTNode> Parser::assign_stmt() {
     const auto kIdentName = scanner_->Curent().GetText();
     ident();
-    auto global_symbol = find_global_symbol(kIdentName);
+    auto symbol = context_.GetSymbolTable().Find(kIdentName);
     auto sym_id = std::make_unique<Value>();
-    sym_id->sym_id = global_symbol;
+    sym_id->sym_id = symbol;
     auto right = ASTNode::MakeAstLeaf(ASTNode::Type::A_LVIDENT, std::move(sym_id));
 
     match(Token::Type::T_ASSIGN);
@@ -220,10 +228,10 @@ std::shared_ptr<ASTNode> Parser::var_decl_stmt() {
     match(Token::Type::T_INT);
     const auto kIdentName = scanner_->Curent().GetText();
     ident();
-    add_global_symbol(kIdentName);
+    auto symbol = context_.GetSymbolTable().Add(kIdentName);
     semi();
     auto value = std::make_unique<Value>();
-    value->sym_id = find_global_symbol(kIdentName);
+    value->sym_id = symbol;
     auto left = ASTNode::MakeAstLeaf(ASTNode::Type::A_VAR_DECL, std::move(value));
     return left;
 }
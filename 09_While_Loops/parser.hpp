@@ -1,5 +1,6 @@
 #pragma once
 #include "ast.hpp"
+#include "context.hpp"
 #include "defs.hpp"
 #include "scan.hpp"
 // Standard includes
@@ -13,11 +14,13 @@
 namespace my_cpp {
 class Parser {
 public:
-    Parser(std::unique_ptr<Scanner> scanner);
+    Parser(std::unique_ptr<Scanner> scanner, CompilationContext &context);
     std::shared_ptr<ASTNode> Parse();
 
 private:
     std::unique_ptr<Scanner> scanner_;
+    CompilationContext &context_;
+    size_t block_depth_ = 0;
 
     std::shared_ptr<ASTNode> primary();
     std::shared_ptr<ASTNode> bin_expr(const size_t prev_precedence = 0);
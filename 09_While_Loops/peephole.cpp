@@ -0,0 +1,271 @@
+#include "peephole.hpp"
+// Standard includes
+// C++ Standard
+#include <array>
+#include <map>
+#include <stdexcept>
+
+namespace my_cpp {
+namespace {
+using Code = std::vector<MachineInstruction>;
+using Kind = MachineInstruction::Kind;
+
+bool is_operation(const MachineInstruction &in, std::string_view op) {
+    return in.kind == Kind::kOperation && in.op == op;
+}
+
+bool is_register(const Operand &operand) {
+    return operand.kind == Operand::Kind::kRegister;
+}
+
+bool is_memory(const Operand &operand) {
+    return operand.kind == Operand::Kind::kMemory || operand.kind == Operand::Kind::kRipRelative;
+}
+
+bool reads_flags(const MachineInstruction &in) {
+    if (in.kind != Kind::kOperation) {
+        return false;
+    }
+    const std::string_view kOp = in.op;
+    return (kOp.front() == 'j' && kOp != "jmp") || kOp.substr(0, 3) == "set"
+            || kOp.substr(0, 4) == "cmov";
+}
+
+// The 32-bit register under a 64-bit one: %r8 -> %r8d, %rcx -> %ecx.
+std::string_view low_half(std::string_view reg) {
+    constexpr std::array<std::pair<std::string_view, std::string_view>, 14> kHalves = {{
+            {"%rax", "%eax"}, {"%rbx", "%ebx"}, {"%rcx", "%ecx"}, {"%rdx", "%edx"},
+            {"%rsi", "%esi"}, {"%rdi", "%edi"}, {"%r8", "%r8d"}, {"%r9", "%r9d"},
+            {"%r10", "%r10d"}, {"%r11", "%r11d"}, {"%r12", "%r12d"}, {"%r13", "%r13d"},
+            {"%r14", "%r14d"}, {"%r15", "%r15d"},
+    }};
+    for (const auto &[kFull, kHalf] : kHalves) {
+        if (kFull == reg) {
+            return kHalf;
+        }
+    }
+    throw std::runtime_error("No 32-bit half of register " + std::string(reg));
+}
+
+// movq %rN, X; movq X, %rM -> movq %rN, X; movq %rN, %rM
+bool forward_store(Code &code) {
+    if (code.size() < 2) {
+        return false;
+    }
+    const auto &store = code[code.size() - 2];
+    auto &load = code.back();
+    if (!is_operation(store, "movq") || !is_operation(load, "movq") || !is_register(store.src)
+        || !is_memory(store.dst) || load.src != store.dst || !is_register(load.dst)) {
+        return false;
+    }
+    load.src = store.src;
+    return true;
+}
+
+// movq %rN, %rN -> nothing
+bool drop_self_move(Code &code) {
+    if (code.empty() || !is_operation(code.back(), "movq") || code.back().src != code.back().dst) {
+        return false;
+    }
+    code.pop_back();
+    return true;
+}
+
+// jmp .Ln; (other labels;) .Ln: -> (other labels;) .Ln:
+bool drop_jump_to_next(Code &code) {
+    if (code.empty() || code.back().kind != Kind::kLabel) {
+        return false;
+    }
+    size_t first_label = code.size() - 1;
+    while (first_label > 0 && code[first_label - 1].kind == Kind::kLabel) {
+        --first_label;
+    }
+    if (first_label == 0 || !is_operation(code[first_label - 1], "jmp")
+        || code[first_label - 1].src != code.back().src) {
+        return false;
+    }
+    code.erase(code.begin() + (first_label - 1));
+    return true;
+}
+
+// Whether an operation sets every flag, so that whatever they held before it is dead.
+bool writes_flags(const MachineInstruction &in) {
+    constexpr std::array<std::string_view, 11> kWriters = {
+            "addq", "subq", "imulq", "negq", "cmpq", "testq", "xorl", "xorq", "andq", "orq",
+            "call"};
+    for (const auto kWriter : kWriters) {
+        if (is_operation(in, kWriter)) {
+            return true;
+        }
+    }
+    // A shift by zero leaves the flags as they were.
+    const bool kShift =
+            is_operation(in, "sarq") || is_operation(in, "shrq") || is_operation(in, "shlq");
+    return kShift && in.src.kind == Operand::Kind::kImmediate && in.src.value % 64 != 0;
+}
+
+using LabelKey = std::pair<std::string_view, int64_t>;
+
+LabelKey label_key(const Operand &label) {
+    return {label.name, label.value};
+}
+
+// Walks the code backwards from its end, where nothing is known and the flags count as live, and
+// calls `visit` on each instruction with whether the flags are live after it. `live_at` holds
+// whether they are live at each label: a label records it and a jmp takes it from its target,
+// or assumes live for a label the code does not define. Returns whether a record changed.
+template <typename Visit>
+bool walk_flags(Code &code, std::map<LabelKey, bool> &live_at, Visit visit) {
+    bool changed = false;
+    bool live = true;
+    for (size_t i = code.size(); i-- > 0;) {
+        auto &in = code[i];
+        visit(in, live);
+        if (in.kind == Kind::kLabel) {
+            bool &recorded = live_at[label_key(in.src)];
+            changed |= recorded != live;
+            recorded = live;
+        } else if (is_operation(in, "jmp")) {
+            const auto kTarget = live_at.find(label_key(in.src));
+            live = kTarget == live_at.end() || kTarget->second;
+        } else if (reads_flags(in)) {
+            live = true;
+        } else if (writes_flags(in)) {
+            live = false;
+        }
+    }
+    return changed;
+}
+
+// movq $0, %rN -> xorl %eN, %eN where no instruction that can run next reads the flags xorl
+// clobbers before they are set again. That reaches past the window and across jumps, so it runs
+// over the finished code instead.
+size_t zero_with_xor(Code &code) {
+    std::map<LabelKey, bool> live_at;
+    for (const auto &in : code) {
+        if (in.kind == Kind::kLabel) {
+            live_at.emplace(label_key(in.src), false);
+        }
+    }
+    // A jump back to a loop head is seen before the head's label, so walk until the records
+    // settle; they only ever go from dead to live.
+    while (walk_flags(code, live_at, [](MachineInstruction &, bool) {})) {
+    }
+    size_t rewritten = 0;
+    walk_flags(code, live_at, [&rewritten](MachineInstruction &move, bool live) {
+        if (live || !is_operation(move, "movq") || move.src.kind != Operand::Kind::kImmediate
+            || move.src.value != 0 || !is_register(move.dst)) {
+            return;
+        }
+        move.op = "xorl";
+        move.dst = low_half(move.dst.name);
+        move.src = move.dst;
+        ++rewritten;
+    });
+    return rewritten;
+}
+
+struct Pattern {
+    std::string_view name;
+    bool (*rewrite)(Code &code);
+};
+
+constexpr std::array<Pattern, 3> kPatterns = {{
+        {"store-reload", forward_store},
+        {"self-move", drop_self_move},
+        {"jump-to-next", drop_jump_to_next},
+}};
+
+void print_operand(const Operand &operand, TextBuffer &out) {
+    switch (operand.kind) {
+    case Operand::Kind::kNone:
+        break;
+    case Operand::Kind::kRegister:
+        out << operand.name;
+        break;
+    case Operand::Kind::kImmediate:
+        out << '$' << operand.value;
+        break;
+    case Operand::Kind::kMemory:
+        if (operand.value != 0 || operand.name.empty()) {
+            out << operand.value;
+        }
+        out << '(' << operand.name;
+        if (!operand.index.empty()) {
+            out << ',' << operand.index << ',' << static_cast<int>(operand.scale);
+        }
+        out << ')';
+        break;
+    case Operand::Kind::kLabel:
+    case Operand::Kind::kRipRelative:
+        out << operand.name;
+        if (operand.numbered) {
+            out << operand.value;
+        }
+        if (operand.kind == Operand::Kind::kRipRelative) {
+            out << "(%rip)";
+        }
+        break;
+    }
+}
+}  // namespace
+
+void PrintMachineCode(const std::vector<MachineInstruction> &code, TextBuffer &out) {
+    for (const auto &in : code) {
+        switch (in.kind) {
+        case Kind::kOperation:
+            out << '\t' << in.op;
+            if (in.src.kind != Operand::Kind::kNone) {
+                out << '\t';
+                print_operand(in.src, out);
+            }
+            if (in.src2.kind != Operand::Kind::kNone) {
+                out << ", ";
+                print_operand(in.src2, out);
+            }
+            if (in.dst.kind != Operand::Kind::kNone) {
+                out << ", ";
+                print_operand(in.dst, out);
+            }
+            out << '\n';
+            break;
+        case Kind::kLabel:
+            print_operand(in.src, out);
+            out << ":" << '\n';
+            break;
+        case Kind::kDirective:
+            out << in.text;
+            break;
+        }
+    }
+}
+
+PeepholeOptimizer::PeepholeOptimizer() {
+    for (const auto &pattern : kPatterns) {
+        hits_.emplace_back(pattern.name, 0);
+    }
+    hits_.emplace_back("zero-idiom", 0);
+}
+
+std::vector<MachineInstruction> PeepholeOptimizer::Run(std::vector<MachineInstruction> code) {
+    Code kept;
+    kept.reserve(code.size());
+    for (auto &in : code) {
+        kept.push_back(std::move(in));
+        for (size_t p = 0; p < kPatterns.size();) {
+            if (kPatterns[p].rewrite(kept)) {
+                ++hits_[p].second;
+                p = 0;
+            } else {
+                ++p;
+            }
+        }
+    }
+    hits_.back().second += zero_with_xor(kept);
+    return kept;
+}
+
+const std::vector<std::pair<std::string_view, size_t>> &PeepholeOptimizer::GetHits() const {
+    return hits_;
+}
+}  // namespace my_cpp
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// An instruction operand in its parts; PrintMachineCode formats it. Names point at text that
+// outlives the code: string literals, the register tables and the function's globals.
+struct Operand {
+    enum class Kind : uint8_t {
+        kNone,
+        kRegister,     // name
+        kImmediate,    // $value
+        kMemory,       // value(name) or value(name,index,scale); name may be empty
+        kLabel,        // name, followed by value if numbered: .L12, printint
+        kRipRelative,  // the same label, then (%rip)
+    };
+    Kind kind = Kind::kNone;
+    bool numbered = false;
+    uint8_t scale = 1;
+    std::string_view name;
+    std::string_view index;
+    int64_t value = 0;
+
+    Operand() = default;
+    // A register, so that register names can be passed where an operand is expected.
+    Operand(std::string_view reg) : kind(Kind::kRegister), name(reg) {
+    }
+    Operand(const char *reg) : Operand(std::string_view(reg)) {
+    }
+
+    bool operator==(const Operand &other) const {
+        return kind == other.kind && numbered == other.numbered && scale == other.scale
+                && name == other.name && index == other.index && value == other.value;
+    }
+    bool operator!=(const Operand &other) const {
+        return !(*this == other);
+    }
+};
+
+// One line of x86 assembly in AT&T operand order, kept apart until it is printed so that passes
+// can still look at it. Only directives own text.
+struct MachineInstruction {
+    enum class Kind : uint8_t {
+        kOperation,  // op src, dst (either may be missing), or op src, src2, dst
+        kLabel,      // src:
+        kDirective,  // text, printed as it is
+    };
+    Kind kind;
+    std::string_view op;
+    Operand src;
+    Operand dst;
+    // The register in the middle of the three-operand imulq $n, src2, dst.
+    Operand src2;
+    std::string text;
+};
+
+void PrintMachineCode(const std::vector<MachineInstruction> &code, TextBuffer &out);
+
+// Rewrites redundant instruction sequences. Instructions are appended one by one and the
+// patterns in the table are matched against the tail of what has been kept so far, which acts
+// as a sliding window; after a rewrite the window is matched again, so one rewrite can enable
+// the next. Directives are never looked through. Zeroing moves become xorl in a final pass over
+// the whole code, since that is only safe where no later instruction reads the flags.
+class PeepholeOptimizer {
+public:
+    PeepholeOptimizer();
+    std::vector<MachineInstruction> Run(std::vector<MachineInstruction> code);
+    // How often each pattern applied, by name, in table order and then zero-idiom.
+    const std::vector<std::pair<std::string_view, size_t>> &GetHits() const;
+
+private:
+    std::vector<std::pair<std::string_view, size_t>> hits_;
+};
+}  // namespace my_cpp
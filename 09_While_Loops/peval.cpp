@@ -0,0 +1,93 @@
+#include "peval.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+// C Standard
+
+namespace my_cpp {
+namespace {
+// Statements without loops or divisions always run to completion and need no snapshot.
+bool may_stop(const ASTNode &node) {
+    if (node.GetOp() == ASTNode::Type::A_WHILE || node.GetOp() == ASTNode::Type::A_DIVIDE) {
+        return true;
+    }
+    return (node.GetLeft() != nullptr && may_stop(*node.GetLeft()))
+            || (node.GetMiddle() != nullptr && may_stop(*node.GetMiddle()))
+            || (node.GetRight() != nullptr && may_stop(*node.GetRight()));
+}
+
+std::vector<const ASTNode *> statements(const ASTNode &root) {
+    std::vector<const ASTNode *> pending = {&root};
+    std::vector<const ASTNode *> result;
+    while (!pending.empty()) {
+        const ASTNode *current = pending.back();
+        pending.pop_back();
+        if (current->GetOp() != ASTNode::Type::A_GLUE) {
+            result.push_back(current);
+            continue;
+        }
+        if (current->GetRight() != nullptr) {
+            pending.push_back(current->GetRight().get());
+        }
+        if (current->GetLeft() != nullptr) {
+            pending.push_back(current->GetLeft().get());
+        }
+    }
+    return result;
+}
+}  // namespace
+
+PartialEvaluator::PartialEvaluator(const CompilationContext &context, size_t fuel)
+    : Interpreter(context, captured_), fuel_(fuel) {
+}
+
+PartialEvaluation PartialEvaluator::Evaluate(const ASTNode &root) {
+    reset();
+    const auto kStatements = statements(root);
+    std::vector<int64_t> saved_slots;
+    size_t saved_output = 0;
+    size_t next = 0;
+    for (; next < kStatements.size(); ++next) {
+        const ASTNode &stmt = *kStatements[next];
+        if (!may_stop(stmt)) {
+            exec(stmt);
+            continue;
+        }
+        saved_slots = slots_;
+        output_.Flush();
+        saved_output = captured_.str().size();
+        try {
+            exec(stmt);
+        } catch (const OutOfFuel &) {
+            break;
+        } catch (const arith::Fault &) {
+            // Left for run time, where it fails the same way after the earlier output.
+            break;
+        }
+    }
+    output_.Flush();
+
+    PartialEvaluation result;
+    result.output = captured_.str();
+    if (next < kStatements.size()) {
+        slots_ = std::move(saved_slots);
+        result.output.resize(saved_output);
+        result.residual.assign(kStatements.begin() + next, kStatements.end());
+    }
+    result.slots = std::move(slots_);
+    return result;
+}
+
+void PartialEvaluator::exec_while(const ASTNode &while_stmt) {
+    while (eval(*while_stmt.GetLeft()) != 0) {
+        if (fuel_ == 0) {
+            throw OutOfFuel{};
+        }
+        --fuel_;
+        if (while_stmt.GetRight() != nullptr) {
+            exec(*while_stmt.GetRight());
+        }
+    }
+}
+}  // namespace my_cpp
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ast.hpp"
+#include "interp.hpp"
+// Standard includes
+// C++ Standard
+#include <sstream>
+#include <string>
+#include <vector>
+// C Standard
+#include <cstddef>
+#include <cstdint>
+
+namespace my_cpp {
+// What is left of a program once a prefix of it has been run at compile time.
+struct PartialEvaluation {
+    // Everything the evaluated prefix printed.
+    std::string output;
+    // Variable values after the prefix, laid out by SymbolTable::GetSlot().
+    std::vector<int64_t> slots;
+    // The outermost statements that still have to run; empty when the whole program was run.
+    std::vector<const ASTNode *> residual;
+};
+
+namespace detail {
+// Constructed before the Interpreter base so that its output buffer can write here.
+struct CapturedOutput {
+    std::ostringstream captured_;
+};
+}  // namespace detail
+
+// Runs the outermost statements of a program one after another in the compiler. Loops share a
+// budget of `fuel` iterations; the statement that exhausts it, or that would fail at run time
+// (a division fault), is rolled back and becomes the first residual statement. Statements are
+// never split: a loop that runs out of fuel is left whole, so a program that is one big loop
+// gets no specialisation at all, not even of the iterations that did run.
+class PartialEvaluator : private detail::CapturedOutput, public Interpreter {
+public:
+    static constexpr size_t kDefaultFuel = 1000000;
+
+    PartialEvaluator(const CompilationContext &context, size_t fuel = kDefaultFuel);
+    PartialEvaluation Evaluate(const ASTNode &root);
+
+private:
+    struct OutOfFuel {};
+
+    size_t fuel_;
+
+    void exec_while(const ASTNode &while_stmt) override;
+};
+}  // namespace my_cpp
@@ -0,0 +1,305 @@
+#include "promote.hpp"
+// Standard includes
+// C++ Standard
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+namespace ir {
+namespace {
+constexpr size_t kNone = static_cast<size_t>(-1);
+constexpr int64_t kMaxLoopDepth = 8;
+
+// A variable as loads and stores name it: whether it is a local, and its global index or frame
+// offset.
+using Variable = std::pair<bool, int64_t>;
+
+struct Promoted {
+    VReg reg;
+    bool stored;
+};
+
+std::optional<Variable> variable_of(const Instruction &in) {
+    switch (in.op) {
+    case Opcode::kLoadGlobal:
+    case Opcode::kStoreGlobal:
+        return Variable{false, in.imm};
+    case Opcode::kLoadLocal:
+    case Opcode::kStoreLocal:
+        return Variable{true, in.imm};
+    default:
+        return std::nullopt;
+    }
+}
+
+bool is_load(const Instruction &in) {
+    return in.op == Opcode::kLoadGlobal || in.op == Opcode::kLoadLocal;
+}
+
+// Instructions that only compute a value, as the operands of a condition do.
+bool computes_value(const Instruction &in) {
+    switch (in.op) {
+    case Opcode::kConst:
+    case Opcode::kMove:
+    case Opcode::kLoadGlobal:
+    case Opcode::kLoadLocal:
+    case Opcode::kAdd:
+    case Opcode::kSub:
+    case Opcode::kMul:
+    case Opcode::kDiv:
+    case Opcode::kCompare:
+    case Opcode::kSelect:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_jump(const Instruction &in) {
+    return in.op == Opcode::kJump || in.op == Opcode::kBranch;
+}
+
+Instruction make_access(const Variable &variable, bool load, VReg reg) {
+    Instruction in;
+    if (load) {
+        in.op = variable.first ? Opcode::kLoadLocal : Opcode::kLoadGlobal;
+        in.dst = reg;
+    } else {
+        in.op = variable.first ? Opcode::kStoreLocal : Opcode::kStoreGlobal;
+        in.a = reg;
+    }
+    in.imm = variable.second;
+    return in;
+}
+
+Instruction make_move(VReg dst, VReg src) {
+    Instruction in;
+    in.op = Opcode::kMove;
+    in.dst = dst;
+    in.a = src;
+    return in;
+}
+}  // namespace
+
+RegisterPromoter::RegisterPromoter(size_t max_promoted) : max_promoted_(max_promoted) {
+}
+
+size_t RegisterPromoter::Run(Function &function) {
+    const auto &code = function.code;
+    std::unordered_map<int64_t, size_t> label_at;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op == Opcode::kLabel) {
+            label_at[code[i].imm] = i;
+        }
+    }
+
+    // Jumps as (target, source), loops as [start label, back jump or branch], and the loop
+    // depth of every instruction as the weight of a variable access there.
+    std::vector<std::pair<size_t, size_t>> jumps;
+    std::vector<std::pair<size_t, size_t>> loops;
+    std::vector<int64_t> depth_change(code.size() + 1, 0);
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!is_jump(code[i])) {
+            continue;
+        }
+        const size_t kTarget = label_at.at(code[i].imm);
+        jumps.emplace_back(kTarget, i);
+        if (kTarget <= i) {
+            loops.emplace_back(kTarget, i);
+            ++depth_change[kTarget];
+            --depth_change[i + 1];
+        }
+    }
+    std::sort(jumps.begin(), jumps.end());
+    // Outermost first: among loops at the same label the longest, then the ones after it.
+    std::sort(loops.begin(), loops.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second > rhs.second;
+    });
+    std::vector<double> weight(code.size());
+    int64_t depth = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        depth += depth_change[i];
+        weight[i] = 1;
+        for (int64_t level = 0; level < std::min(depth, kMaxLoopDepth); ++level) {
+            weight[i] *= 10;
+        }
+    }
+
+    const size_t kVRegs = function.num_vregs;
+    std::vector<size_t> def_count(kVRegs, 0), use_count(kVRegs, 0), last_use(kVRegs, kNone);
+    for (size_t i = 0; i < code.size(); ++i) {
+        for (VReg v : {code[i].a, code[i].b, code[i].c}) {
+            if (v != kNoVReg) {
+                ++use_count[v];
+                last_use[v] = i;
+            }
+        }
+        if (code[i].dst != kNoVReg) {
+            ++def_count[code[i].dst];
+        }
+    }
+
+    // Control may only enter at the start, and only leave through the label that follows the
+    // back jump; that is where the promoted values are stored back.
+    const auto kWellFormed = [&](size_t begin, size_t end) {
+        if (end + 1 >= code.size() || code[end + 1].op != Opcode::kLabel) {
+            return false;
+        }
+        for (auto it = std::lower_bound(jumps.begin(), jumps.end(), std::pair{begin, size_t{0}});
+             it != jumps.end() && it->first <= end + 1; ++it) {
+            if (it->second < begin || it->second > end) {
+                return false;
+            }
+        }
+        for (size_t i = begin; i <= end; ++i) {
+            if (is_jump(code[i])) {
+                const size_t kTarget = label_at.at(code[i].imm);
+                if (kTarget < begin || kTarget > end + 1) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    std::vector<Instruction> out;
+    size_t copied = 0;
+    size_t promoted_count = 0;
+    size_t outer_end = kNone;
+    for (const auto &[start, end] : loops) {
+        if (outer_end != kNone && start <= outer_end) {
+            continue;
+        }
+        outer_end = end;
+        // A rotated loop's guard skips it by jumping straight to the exit, so it goes with the
+        // loop, together with the computation of its operands: the values are loaded in front
+        // of it and stored back, unchanged, on that path.
+        size_t begin = start;
+        if (start > 0 && code[start - 1].op == Opcode::kBranch && end + 1 < code.size()
+            && code[end + 1].op == Opcode::kLabel && code[start - 1].imm == code[end + 1].imm) {
+            begin = start - 1;
+            while (begin > copied && computes_value(code[begin - 1])) {
+                --begin;
+            }
+        }
+        if (!kWellFormed(begin, end)) {
+            continue;
+        }
+
+        std::map<Variable, double> variable_weight;
+        std::vector<Variable> candidates;
+        for (size_t i = begin; i <= end; ++i) {
+            if (auto variable = variable_of(code[i])) {
+                if (variable_weight.emplace(*variable, 0).second) {
+                    candidates.push_back(*variable);
+                }
+                variable_weight[*variable] += weight[i];
+            }
+        }
+        if (candidates.empty()) {
+            continue;
+        }
+        std::stable_sort(
+                candidates.begin(), candidates.end(), [&](const auto &lhs, const auto &rhs) {
+                    return variable_weight[lhs] > variable_weight[rhs];
+                });
+        candidates.resize(std::min(candidates.size(), max_promoted_));
+
+        out.insert(out.end(), code.begin() + copied, code.begin() + begin);
+        std::map<Variable, Promoted> promoted;
+        for (const auto &variable : candidates) {
+            const VReg kReg = static_cast<VReg>(function.num_vregs++);
+            promoted.emplace(variable, Promoted{kReg, false});
+            out.push_back(make_access(variable, true, kReg));
+        }
+
+        // A load can hand its users the promoted register itself if they are done with the
+        // value before the variable is stored to again.
+        std::vector<size_t> next_store(end - begin + 1, end + 1);
+        std::map<Variable, size_t> upcoming;
+        for (size_t i = end + 1; i-- > begin;) {
+            const auto variable = variable_of(code[i]);
+            if (!variable || promoted.count(*variable) == 0) {
+                continue;
+            }
+            if (is_load(code[i])) {
+                auto it = upcoming.find(*variable);
+                next_store[i - begin] = it != upcoming.end() ? it->second : end + 1;
+            } else {
+                upcoming[*variable] = i;
+            }
+        }
+
+        std::unordered_map<VReg, VReg> renamed;
+        std::unordered_map<VReg, size_t> def_at;
+        const size_t kLoopStart = out.size();
+        for (size_t i = begin; i <= end; ++i) {
+            Instruction in = code[i];
+            for (VReg *v : {&in.a, &in.b, &in.c}) {
+                if (auto it = renamed.find(*v); it != renamed.end()) {
+                    *v = it->second;
+                }
+            }
+            const auto variable = variable_of(in);
+            auto it = variable ? promoted.find(*variable) : promoted.end();
+            if (it == promoted.end()) {
+                if (in.dst != kNoVReg && in.dst < kVRegs) {
+                    def_at[in.dst] = out.size();
+                }
+                out.push_back(in);
+                continue;
+            }
+            const VReg kReg = it->second.reg;
+            if (is_load(in)) {
+                if (def_count[in.dst] == 1
+                    && (last_use[in.dst] == kNone || last_use[in.dst] < next_store[i - begin])) {
+                    renamed[in.dst] = kReg;
+                } else {
+                    def_at[in.dst] = out.size();
+                    out.push_back(make_move(in.dst, kReg));
+                }
+                continue;
+            }
+            it->second.stored = true;
+            if (in.a == kReg) {
+                continue;
+            }
+            // The stored value is computed straight into the promoted register when nothing in
+            // between touches it.
+            auto def = def_at.find(in.a);
+            if (def != def_at.end() && def->second >= kLoopStart && def_count[in.a] == 1
+                && use_count[in.a] == 1
+                && std::none_of(
+                        out.begin() + def->second + 1, out.end(), [kReg](const Instruction &x) {
+                            return x.a == kReg || x.b == kReg || x.c == kReg || x.dst == kReg;
+                        })) {
+                out[def->second].dst = kReg;
+                continue;
+            }
+            out.push_back(make_move(kReg, in.a));
+        }
+
+        out.push_back(code[end + 1]);
+        for (const auto &[variable, value] : promoted) {
+            if (value.stored) {
+                out.push_back(make_access(variable, false, value.reg));
+            }
+        }
+        copied = end + 2;
+        promoted_count += promoted.size();
+    }
+    if (promoted_count == 0) {
+        return 0;
+    }
+    out.insert(out.end(), code.begin() + copied, code.end());
+    function.code = std::move(out);
+    return promoted_count;
+}
+}  // namespace ir
+}  // namespace my_cpp
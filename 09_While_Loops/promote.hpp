@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+namespace ir {
+// Keeps the variables an outermost loop uses most in virtual registers while it runs. They are
+// loaded once in front of the loop (and of its guard, if it was rotated), every load and store
+// inside becomes a register move (or disappears when the value can be used or computed in
+// place), and the ones the loop writes are stored back once at its exit. Loops entered or left
+// other than at their start and end labels are left alone.
+class RegisterPromoter {
+public:
+    explicit RegisterPromoter(size_t max_promoted);
+    // Returns the number of variables promoted, counted once per loop.
+    size_t Run(Function &function);
+
+private:
+    size_t max_promoted_;
+};
+}  // namespace ir
+}  // namespace my_cpp
@@ -0,0 +1,522 @@
+#include "regalloc.hpp"
+// Standard includes
+// C++ Standard
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+namespace ir {
+namespace {
+constexpr size_t kNone = static_cast<size_t>(-1);
+// Deeper loops weigh no more than this; the exact factor no longer matters there.
+constexpr size_t kMaxLoopDepth = 8;
+}  // namespace
+
+size_t Allocation::RegisterAt(VReg vreg, size_t position) const {
+    for (size_t i = first[vreg]; i != kNoSegment; i = segments[i].next) {
+        if (segments[i].start <= position && position <= segments[i].end) {
+            return segments[i].reg;
+        }
+    }
+    throw std::runtime_error("Value is not live");
+}
+
+LinearScanAllocator::LinearScanAllocator(size_t num_registers, size_t first_callee_saved)
+    : num_registers_(num_registers),
+      first_callee_saved_(first_callee_saved) {
+}
+
+void LinearScanAllocator::number_uses(const Function &function) {
+    use_begin_.assign(function.num_vregs + 1, 0);
+    for (const auto &in : function.code) {
+        for (VReg v : {in.a, in.b, in.c}) {
+            if (v != kNoVReg) {
+                ++use_begin_[v + 1];
+            }
+        }
+    }
+    for (size_t v = 0; v < function.num_vregs; ++v) {
+        use_begin_[v + 1] += use_begin_[v];
+    }
+    uses_.resize(use_begin_.back());
+    std::vector<size_t> fill(use_begin_.begin(), use_begin_.end() - 1);
+    for (size_t i = 0; i < function.code.size(); ++i) {
+        const auto &in = function.code[i];
+        // An instruction reading the same value twice still counts one use per operand.
+        for (VReg v : {in.a, in.b, in.c}) {
+            if (v != kNoVReg) {
+                uses_[fill[v]++] = 2 * i;
+            }
+        }
+    }
+}
+
+// A jump or branch back to an earlier label closes a loop over everything in between.
+void LinearScanAllocator::weigh_loops(const Function &function) {
+    const auto &code = function.code;
+    std::unordered_map<int64_t, size_t> label_at;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].op == Opcode::kLabel) {
+            label_at[code[i].imm] = i;
+        }
+    }
+    std::vector<int64_t> depth_change(code.size() + 1, 0);
+    calls_.clear();
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (IsCall(code[i])) {
+            calls_.push_back(i);
+        }
+        if (code[i].op != Opcode::kJump && code[i].op != Opcode::kBranch) {
+            continue;
+        }
+        if (auto it = label_at.find(code[i].imm); it != label_at.end() && it->second <= i) {
+            ++depth_change[it->second];
+            --depth_change[i + 1];
+        }
+    }
+    use_weight_.resize(code.size());
+    int64_t depth = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        depth += depth_change[i];
+        double weight = 1;
+        for (int64_t level = 0; level < std::min<int64_t>(depth, kMaxLoopDepth); ++level) {
+            weight *= 10;
+        }
+        use_weight_[i] = weight;
+    }
+}
+
+// The positions each virtual register is live at, as sorted disjoint ranges. Liveness across
+// basic blocks is only solved for the values that cross one; each block is then walked backwards
+// from what is live out of it, a use opening a range and a definition closing it. A definition
+// nothing reads still gets its own position.
+void LinearScanAllocator::build_ranges(const Function &function) {
+    const auto &code = function.code;
+    std::vector<size_t> begins;
+    std::unordered_map<int64_t, size_t> label_block;
+    for (size_t i = 0; i < code.size(); ++i) {
+        const bool kLeader = i == 0 || code[i].op == Opcode::kLabel
+                || code[i - 1].op == Opcode::kJump || code[i - 1].op == Opcode::kBranch;
+        if (kLeader) {
+            begins.push_back(i);
+        }
+        if (code[i].op == Opcode::kLabel) {
+            label_block[code[i].imm] = begins.size() - 1;
+        }
+    }
+    begins.push_back(code.size());
+    const size_t kBlocks = begins.size() - 1;
+
+    std::vector<size_t> def_block(function.num_vregs, kNone);
+    std::vector<size_t> global_id(function.num_vregs, kNone);
+    std::vector<VReg> globals;
+    for (size_t b = 0; b < kBlocks; ++b) {
+        for (size_t i = begins[b]; i < begins[b + 1]; ++i) {
+            const auto &in = code[i];
+            for (VReg v : {in.a, in.b, in.c}) {
+                if (v != kNoVReg && def_block[v] != b && global_id[v] == kNone) {
+                    global_id[v] = globals.size();
+                    globals.push_back(v);
+                }
+            }
+            if (in.dst != kNoVReg) {
+                def_block[in.dst] = b;
+            }
+        }
+    }
+
+    using Bits = std::vector<uint64_t>;
+    const size_t kWords = (globals.size() + 63) / 64;
+    const auto test = [](const Bits &bits, size_t i) { return (bits[i / 64] >> (i % 64)) & 1; };
+    const auto set = [](Bits &bits, size_t i) { bits[i / 64] |= uint64_t{1} << (i % 64); };
+    std::vector<Bits> gen(kBlocks, Bits(kWords)), kill(kBlocks, Bits(kWords));
+    std::vector<Bits> live_in(kBlocks, Bits(kWords)), live_out(kBlocks, Bits(kWords));
+    std::vector<std::vector<size_t>> successors(kBlocks);
+    for (size_t b = 0; b < kBlocks; ++b) {
+        for (size_t i = begins[b]; i < begins[b + 1]; ++i) {
+            const auto &in = code[i];
+            for (VReg v : {in.a, in.b, in.c}) {
+                if (v != kNoVReg && global_id[v] != kNone && !test(kill[b], global_id[v])) {
+                    set(gen[b], global_id[v]);
+                }
+            }
+            if (in.dst != kNoVReg && global_id[in.dst] != kNone) {
+                set(kill[b], global_id[in.dst]);
+            }
+        }
+        const auto &last = code[begins[b + 1] - 1];
+        if (last.op == Opcode::kJump || last.op == Opcode::kBranch) {
+            successors[b].push_back(label_block.at(last.imm));
+        }
+        if (FallsThrough(last) && b + 1 < kBlocks) {
+            successors[b].push_back(b + 1);
+        }
+    }
+    for (bool changed = !globals.empty(); changed;) {
+        changed = false;
+        for (size_t b = kBlocks; b-- > 0;) {
+            Bits out(kWords);
+            for (size_t s : successors[b]) {
+                for (size_t w = 0; w < kWords; ++w) {
+                    out[w] |= live_in[s][w];
+                }
+            }
+            Bits in(kWords);
+            for (size_t w = 0; w < kWords; ++w) {
+                in[w] = gen[b][w] | (out[w] & ~kill[b][w]);
+            }
+            if (in != live_in[b] || out != live_out[b]) {
+                live_in[b] = std::move(in);
+                live_out[b] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+
+    ranges_.assign(function.num_vregs, {});
+    std::vector<size_t> open(function.num_vregs, kNone);
+    std::vector<VReg> opened;
+    for (size_t b = kBlocks; b-- > 0;) {
+        opened.clear();
+        for (size_t g = 0; g < globals.size(); ++g) {
+            if (test(live_out[b], g)) {
+                open[globals[g]] = 2 * begins[b + 1] - 1;
+                opened.push_back(globals[g]);
+            }
+        }
+        for (size_t i = begins[b + 1]; i-- > begins[b];) {
+            const auto &in = code[i];
+            if (in.dst != kNoVReg) {
+                const size_t kEnd = open[in.dst] != kNone ? open[in.dst] : 2 * i + 1;
+                ranges_[in.dst].emplace_back(2 * i + 1, kEnd);
+                open[in.dst] = kNone;
+            }
+            for (VReg v : {in.a, in.b, in.c}) {
+                if (v != kNoVReg && open[v] == kNone) {
+                    open[v] = 2 * i;
+                    opened.push_back(v);
+                }
+            }
+        }
+        for (VReg v : opened) {
+            if (open[v] != kNone) {
+                ranges_[v].emplace_back(2 * begins[b], open[v]);
+                open[v] = kNone;
+            }
+        }
+    }
+    for (auto &ranges : ranges_) {
+        std::sort(ranges.begin(), ranges.end());
+        size_t kept = 0;
+        for (const auto &range : ranges) {
+            if (kept > 0 && range.first <= ranges[kept - 1].second + 1) {
+                ranges[kept - 1].second = std::max(ranges[kept - 1].second, range.second);
+            } else {
+                ranges[kept++] = range;
+            }
+        }
+        ranges.resize(kept);
+    }
+}
+
+// The first position in [from, to] that both virtual registers are live at, or kNone.
+size_t LinearScanAllocator::intersection(VReg a, VReg b, size_t from, size_t to) const {
+    const auto kEndsBefore = [](const std::pair<size_t, size_t> &range, size_t position) {
+        return range.second < position;
+    };
+    auto i = std::lower_bound(ranges_[a].begin(), ranges_[a].end(), from, kEndsBefore);
+    auto j = std::lower_bound(ranges_[b].begin(), ranges_[b].end(), from, kEndsBefore);
+    while (i != ranges_[a].end() && j != ranges_[b].end()) {
+        const size_t kLow = std::max({i->first, j->first, from});
+        if (kLow > to) {
+            break;
+        }
+        if (kLow <= std::min(i->second, j->second)) {
+            return kLow;
+        }
+        if (i->second < j->second) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    return kNone;
+}
+
+size_t LinearScanAllocator::next_use(VReg vreg, size_t position, size_t end) const {
+    const auto kFirst = uses_.begin() + use_begin_[vreg];
+    const auto kLast = uses_.begin() + use_begin_[vreg + 1];
+    const auto kUse = std::lower_bound(kFirst, kLast, position);
+    return kUse != kLast && *kUse <= end ? *kUse : kNone;
+}
+
+// A long interval is no cheaper to spill than a short one, since a spilled value is back in a
+// register at its next use; what it costs is a reload for each of them.
+double LinearScanAllocator::spill_weight(VReg vreg, size_t start, size_t end) const {
+    double weight = 0;
+    for (size_t i = use_begin_[vreg]; i < use_begin_[vreg + 1]; ++i) {
+        if (start <= uses_[i] && uses_[i] <= end) {
+            weight += use_weight_[uses_[i] / 2];
+        }
+    }
+    return weight;
+}
+
+// Whether the value must survive a call: live both when it reads its arguments and after it.
+bool LinearScanAllocator::crosses_call(VReg vreg, size_t start, size_t end) const {
+    for (auto call = std::lower_bound(calls_.begin(), calls_.end(), (start + 1) / 2);
+         call != calls_.end() && 2 * *call + 1 <= end; ++call) {
+        if (intersection(vreg, vreg, 2 * *call, 2 * *call + 1) == 2 * *call) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Stack slots are shared by spilled values whose whole lifetimes do not overlap.
+void LinearScanAllocator::assign_slots(
+        Allocation &allocation,
+        const std::vector<bool> &spilled) const {
+    std::vector<std::pair<size_t, VReg>> lifetimes;
+    for (VReg v = 0; v < spilled.size(); ++v) {
+        if (spilled[v]) {
+            lifetimes.emplace_back(allocation.segments[allocation.first[v]].start, v);
+        }
+    }
+    std::sort(lifetimes.begin(), lifetimes.end());
+    using Busy = std::pair<size_t, size_t>;
+    std::priority_queue<Busy, std::vector<Busy>, std::greater<Busy>> busy;
+    std::vector<size_t> free_slots;
+    allocation.slots.assign(spilled.size(), Allocation::kNoSlot);
+    for (const auto &[start, v] : lifetimes) {
+        while (!busy.empty() && busy.top().first < start) {
+            free_slots.push_back(busy.top().second);
+            busy.pop();
+        }
+        size_t slot;
+        if (free_slots.empty()) {
+            slot = allocation.num_slots++;
+        } else {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        size_t end = start;
+        for (size_t i = allocation.first[v]; i != Allocation::kNoSegment;
+             i = allocation.segments[i].next) {
+            end = allocation.segments[i].end;
+        }
+        allocation.slots[v] = slot;
+        busy.emplace(end, slot);
+    }
+}
+
+Allocation LinearScanAllocator::Run(const Function &function) {
+    number_uses(function);
+    weigh_loops(function);
+    build_ranges(function);
+
+    Allocation allocation;
+    auto &segments = allocation.segments;
+    allocation.first.assign(function.num_vregs, Allocation::kNoSegment);
+    allocation.used.assign(num_registers_, false);
+    std::vector<VReg> owner;
+    using Entry = std::pair<size_t, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> unhandled;
+    for (VReg v = 0; v < function.num_vregs; ++v) {
+        if (!ranges_[v].empty()) {
+            const size_t kStart = ranges_[v].front().first;
+            allocation.first[v] = segments.size();
+            unhandled.emplace(kStart, segments.size());
+            segments.push_back(
+                    {kStart, ranges_[v].back().second, Allocation::kMemory,
+                     Allocation::kNoSegment});
+            owner.push_back(v);
+        }
+    }
+    // Cuts a segment in two at `at` and returns the new second half, which starts in memory.
+    const auto split = [&segments, &owner](size_t segment, size_t at) {
+        const size_t kTail = segments.size();
+        segments.push_back(
+                {at, segments[segment].end, Allocation::kMemory, segments[segment].next});
+        owner.push_back(owner[segment]);
+        segments[segment].end = at - 1;
+        segments[segment].next = kTail;
+        return kTail;
+    };
+    std::vector<bool> spilled(function.num_vregs, false);
+    // Sends a segment to memory from `at`, where its value is live, until its next use, which
+    // goes back to be allocated again.
+    const auto spill_from = [&](size_t segment, size_t at) {
+        const size_t kTail = split(segment, at);
+        const size_t kNextUse = next_use(owner[kTail], at, segments[kTail].end);
+        if (kNextUse == at) {
+            unhandled.emplace(at, kTail);
+        } else if (kNextUse != kNone) {
+            unhandled.emplace(kNextUse, split(kTail, kNextUse));
+        }
+        ++allocation.splits;
+        spilled[owner[kTail]] = true;
+    };
+    // The register an operand of the definition at `position` leaves there, so that the result
+    // can take it over and x86's two-address forms need no copy: the first operand of a move,
+    // add, subtraction or multiplication, or the second of an add or multiplication.
+    const auto hint = [&](VReg vreg, size_t position) {
+        const auto &in = function.code[position / 2];
+        if (position % 2 == 0 || in.dst != vreg) {
+            return Allocation::kMemory;
+        }
+        std::vector<VReg> operands;
+        if (in.op == Opcode::kMove || in.op == Opcode::kSub) {
+            operands = {in.a};
+        } else if (in.op == Opcode::kAdd || in.op == Opcode::kMul) {
+            operands = {in.a, in.b};
+        }
+        for (VReg operand : operands) {
+            if (operand == kNoVReg) {
+                continue;
+            }
+            for (size_t i = allocation.first[operand]; i != Allocation::kNoSegment;
+                 i = segments[i].next) {
+                if (segments[i].start <= position - 1 && position - 1 <= segments[i].end) {
+                    if (segments[i].reg != Allocation::kMemory) {
+                        return segments[i].reg;
+                    }
+                    break;
+                }
+            }
+        }
+        return Allocation::kMemory;
+    };
+
+    // The segments holding each register that have not ended, whether or not their value is live.
+    std::vector<std::vector<size_t>> holders(num_registers_);
+    while (!unhandled.empty()) {
+        const size_t kCurrent = unhandled.top().second;
+        unhandled.pop();
+        const VReg kVReg = owner[kCurrent];
+        const size_t kStart = segments[kCurrent].start;
+        for (auto &held : holders) {
+            held.erase(std::remove_if(held.begin(), held.end(),
+                                      [&segments, kStart](size_t segment) {
+                                          return segments[segment].end < kStart;
+                                      }),
+                       held.end());
+        }
+        // The first position the current segment needs `reg` at while another holds it, or kNone.
+        const auto free_until = [&](size_t reg) {
+            size_t until = kNone;
+            for (size_t held : holders[reg]) {
+                until = std::min(
+                        until,
+                        intersection(
+                                owner[held],
+                                kVReg,
+                                std::max(segments[held].start, kStart),
+                                std::min(segments[held].end, segments[kCurrent].end)));
+            }
+            return until;
+        };
+
+        const size_t kLowest =
+                crosses_call(kVReg, kStart, segments[kCurrent].end) ? first_callee_saved_ : 0;
+        // Holes are only filled when no register is free outright, since the value around a
+        // hole is often the result that the instructions in it compute into.
+        size_t reg = Allocation::kMemory;
+        size_t reg_free = kStart;
+        for (size_t r = kLowest; r < num_registers_; ++r) {
+            const size_t kFree = free_until(r);
+            const bool kEmpty = holders[r].empty();
+            if (kFree > reg_free
+                || (kFree == reg_free && reg != Allocation::kMemory && kEmpty
+                    && !holders[reg].empty())) {
+                reg = r;
+                reg_free = kFree;
+            }
+        }
+        const size_t kHint = hint(kVReg, kStart);
+        if (reg_free > segments[kCurrent].end && kHint != Allocation::kMemory
+            && kHint >= kLowest && free_until(kHint) > segments[kCurrent].end) {
+            reg = kHint;
+        }
+        if (reg != Allocation::kMemory) {
+            // Free for a while: take it up to where it is needed again.
+            if (reg_free <= segments[kCurrent].end) {
+                spill_from(kCurrent, reg_free);
+            }
+        } else {
+            // Every register is live here: pick the cheapest holder not read right here.
+            size_t evicted = Allocation::kNoSegment;
+            double reg_weight = 0;
+            for (size_t r = kLowest; r < num_registers_; ++r) {
+                for (size_t held : holders[r]) {
+                    const auto &segment = segments[held];
+                    if (segment.start >= kStart
+                        || intersection(owner[held], owner[held], kStart, kStart) != kStart
+                        || next_use(owner[held], kStart, segment.end) == kStart) {
+                        continue;
+                    }
+                    const double kWeight = spill_weight(owner[held], kStart, segment.end);
+                    if (reg == Allocation::kMemory || kWeight < reg_weight) {
+                        reg = r;
+                        evicted = held;
+                        reg_weight = kWeight;
+                    }
+                }
+            }
+            const size_t kNextUse = next_use(kVReg, kStart, segments[kCurrent].end);
+            if (kNextUse != kStart
+                && (reg == Allocation::kMemory
+                    || spill_weight(kVReg, kStart, segments[kCurrent].end) <= reg_weight)) {
+                if (kNextUse != kNone) {
+                    unhandled.emplace(kNextUse, split(kCurrent, kNextUse));
+                    ++allocation.splits;
+                }
+                spilled[kVReg] = true;
+                continue;
+            }
+            if (reg == Allocation::kMemory) {
+                throw std::runtime_error("Out of registers");
+            }
+            spill_from(evicted, kStart);
+            // Others holding it may still need it later on.
+            if (const size_t kFree = free_until(reg); kFree <= segments[kCurrent].end) {
+                spill_from(kCurrent, kFree);
+            }
+        }
+        holders[reg].push_back(kCurrent);
+        segments[kCurrent].reg = reg;
+        allocation.used[reg] = true;
+    }
+
+    // Each segment is cut down to the ranges it is live in, so that none spans a hole.
+    std::vector<Segment> pieces;
+    for (VReg v = 0; v < function.num_vregs; ++v) {
+        const size_t kHead = allocation.first[v];
+        allocation.first[v] = Allocation::kNoSegment;
+        size_t last = Allocation::kNoSegment;
+        for (size_t i = kHead; i != Allocation::kNoSegment; i = segments[i].next) {
+            for (const auto &[kFrom, kTo] : ranges_[v]) {
+                const size_t kLow = std::max(kFrom, segments[i].start);
+                const size_t kHigh = std::min(kTo, segments[i].end);
+                if (kLow > kHigh) {
+                    continue;
+                }
+                (last == Allocation::kNoSegment ? allocation.first[v] : pieces[last].next) =
+                        pieces.size();
+                last = pieces.size();
+                pieces.push_back({kLow, kHigh, segments[i].reg, Allocation::kNoSegment});
+            }
+        }
+    }
+    segments = std::move(pieces);
+    allocation.spilled = static_cast<size_t>(std::count(spilled.begin(), spilled.end(), true));
+    assign_slots(allocation, spilled);
+    return allocation;
+}
+}  // namespace ir
+}  // namespace my_cpp
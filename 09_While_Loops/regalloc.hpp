@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+namespace ir {
+// Where one virtual register lives over the positions [start, end]. Instruction i reads its
+// operands at position 2i and writes its result at 2i + 1.
+struct Segment {
+    size_t start;
+    size_t end;
+    size_t reg;
+    size_t next;
+};
+
+// The result of register allocation. Each virtual register has a chain of segments in position
+// order, covering only the positions it is live at; a value is only ever in memory between its
+// uses, never at one. Every virtual register that spends any segment in memory owns a stack slot,
+// and every write to it also goes to that slot, so the slot is always current and a register
+// segment may be entered by simply reloading.
+struct Allocation {
+    static constexpr size_t kMemory = static_cast<size_t>(-1);
+    static constexpr size_t kNoSegment = static_cast<size_t>(-1);
+    static constexpr size_t kNoSlot = static_cast<size_t>(-1);
+
+    // Head of each virtual register's chain, or kNoSegment if it never occurs.
+    std::vector<size_t> first;
+    std::vector<Segment> segments;
+    std::vector<size_t> slots;
+    size_t num_slots = 0;
+    // Machine registers handed out at least once.
+    std::vector<bool> used;
+    size_t spilled = 0;
+    size_t splits = 0;
+
+    // The machine register `vreg` is in at `position`, or kMemory.
+    size_t RegisterAt(VReg vreg, size_t position) const;
+};
+
+// Linear-scan allocation over live intervals with lifetime holes. Liveness is solved per basic
+// block, and only for values that cross one; each value then gets the ranges of positions it is
+// live at, and a register is shared by intervals that are never live at once. Intervals are
+// handed machine registers in order of start, preferring one an operand of their definition
+// leaves. A register free for only part of an interval is taken up to where it is needed again.
+// When none is free, the interval with the lower spill weight (uses, scaled by 10 per loop
+// level) goes to memory until its next use and is split there; the rest of it is allocated
+// again later. Intervals that are live across a call only get the callee-saved registers, which
+// are numbered from `first_callee_saved` up to `num_registers`.
+class LinearScanAllocator {
+public:
+    LinearScanAllocator(size_t num_registers, size_t first_callee_saved);
+    Allocation Run(const Function &function);
+
+private:
+    size_t num_registers_;
+    size_t first_callee_saved_;
+
+    // Read positions of each virtual register, in order: uses_[use_begin_[v] .. use_begin_[v+1]).
+    std::vector<size_t> use_begin_;
+    std::vector<size_t> uses_;
+    // Weight of a use at each instruction, 10 to the power of its loop depth.
+    std::vector<double> use_weight_;
+    std::vector<size_t> calls_;
+    // Live ranges [start, end] of each virtual register, sorted and disjoint.
+    std::vector<std::vector<std::pair<size_t, size_t>>> ranges_;
+
+    void number_uses(const Function &function);
+    void weigh_loops(const Function &function);
+    void build_ranges(const Function &function);
+    size_t intersection(VReg a, VReg b, size_t from, size_t to) const;
+    size_t next_use(VReg vreg, size_t position, size_t end) const;
+    double spill_weight(VReg vreg, size_t start, size_t end) const;
+    bool crosses_call(VReg vreg, size_t start, size_t end) const;
+    void assign_slots(Allocation &allocation, const std::vector<bool> &spilled) const;
+};
+}  // namespace ir
+}  // namespace my_cpp
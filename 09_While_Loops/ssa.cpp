@@ -0,0 +1,1214 @@
+#include "ssa.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+// C Standard
+#include <cstdint>
+
+namespace my_cpp {
+namespace ir {
+namespace {
+// A variable as loads and stores name it: whether it is a local, and its global index or frame
+// offset.
+using Variable = std::pair<bool, int64_t>;
+
+std::optional<Variable> variable_of(const Instruction &in) {
+    switch (in.op) {
+    case Opcode::kLoadGlobal:
+    case Opcode::kStoreGlobal:
+        return Variable{false, in.imm};
+    case Opcode::kLoadLocal:
+    case Opcode::kStoreLocal:
+        return Variable{true, in.imm};
+    default:
+        return std::nullopt;
+    }
+}
+
+bool is_load(const Instruction &in) {
+    return in.op == Opcode::kLoadGlobal || in.op == Opcode::kLoadLocal;
+}
+
+bool is_terminator(const Instruction &in) {
+    return in.op == Opcode::kJump || in.op == Opcode::kBranch;
+}
+
+bool holds(Condition cond, int64_t left, int64_t right) {
+    switch (cond) {
+    case Condition::kEq:
+        return left == right;
+    case Condition::kNe:
+        return left != right;
+    case Condition::kLt:
+        return left < right;
+    case Condition::kGt:
+        return left > right;
+    case Condition::kLe:
+        return left <= right;
+    case Condition::kGe:
+        return left >= right;
+    }
+    return false;
+}
+
+// Instructions that only compute their value and cannot fault; a division is judged separately.
+bool is_pure(const Instruction &in) {
+    switch (in.op) {
+    case Opcode::kConst:
+    case Opcode::kMove:
+    case Opcode::kLoadGlobal:
+    case Opcode::kLoadLocal:
+    case Opcode::kAdd:
+    case Opcode::kSub:
+    case Opcode::kMul:
+    case Opcode::kCompare:
+    case Opcode::kSelect:
+        return true;
+    default:
+        return false;
+    }
+}
+
+Instruction make_move(VReg dst, VReg src) {
+    Instruction in;
+    in.op = Opcode::kMove;
+    in.dst = dst;
+    in.a = src;
+    return in;
+}
+
+Instruction make_control(Opcode op, int64_t label) {
+    Instruction in;
+    in.op = op;
+    in.imm = label;
+    return in;
+}
+
+// The lattice of sparse conditional constant propagation: not known yet, one constant, or more
+// than one value.
+struct Value {
+    enum class Lattice : uint8_t {
+        kUnknown,
+        kConstant,
+        kVarying,
+    };
+    Lattice lattice = Lattice::kUnknown;
+    int64_t constant = 0;
+
+    bool operator==(const Value &other) const {
+        return lattice == other.lattice
+                && (lattice != Lattice::kConstant || constant == other.constant);
+    }
+};
+using Lattice = Value::Lattice;
+
+Value meet(const Value &lhs, const Value &rhs) {
+    if (lhs.lattice == Lattice::kUnknown) {
+        return rhs;
+    }
+    if (rhs.lattice == Lattice::kUnknown || lhs == rhs) {
+        return lhs;
+    }
+    return {Lattice::kVarying, 0};
+}
+}  // namespace
+
+bool SSAOptimizer::Run(Function &function) {
+    statistics_ = {};
+    std::vector<size_t> def_count(function.num_vregs, 0);
+    for (const auto &in : function.code) {
+        if (in.dst != kNoVReg && ++def_count[in.dst] > 1) {
+            return false;
+        }
+    }
+    if (function.code.empty()) {
+        return true;
+    }
+    function_ = &function;
+    alias_.resize(function.num_vregs);
+    std::iota(alias_.begin(), alias_.end(), VReg{0});
+
+    build_blocks();
+    compute_dominators();
+    construct_ssa();
+    propagate_constants();
+    compute_dominators();
+    remove_trivial_phis();
+    number_values();
+    remove_trivial_phis();
+    remove_dead();
+    leave_ssa();
+
+    function_ = nullptr;
+    blocks_.clear();
+    edges_.clear();
+    alias_.clear();
+    return true;
+}
+
+const SSAOptimizer::Statistics &SSAOptimizer::GetStatistics() const {
+    return statistics_;
+}
+
+VReg SSAOptimizer::vreg_new() {
+    const VReg kVReg = static_cast<VReg>(function_->num_vregs++);
+    alias_.push_back(kVReg);
+    return kVReg;
+}
+
+VReg SSAOptimizer::resolve(VReg vreg) const {
+    while (vreg != kNoVReg && alias_[vreg] != vreg) {
+        vreg = alias_[vreg];
+    }
+    return vreg;
+}
+
+// A block starts at every label and after every jump or branch. Block 0 is an empty entry with
+// no predecessors, where the variables get their initial values.
+void SSAOptimizer::build_blocks() {
+    const auto &code = function_->code;
+    blocks_.assign(1, Block{});
+    edges_.clear();
+    std::unordered_map<int64_t, size_t> label_block;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (i == 0 || code[i].op == Opcode::kLabel || is_terminator(code[i - 1])) {
+            blocks_.emplace_back();
+        }
+        if (code[i].op == Opcode::kLabel) {
+            label_block[code[i].imm] = blocks_.size() - 1;
+        }
+        blocks_.back().code.push_back(code[i]);
+    }
+
+    const auto add_edge = [this](size_t from, size_t to, bool taken) {
+        blocks_[from].out.push_back(edges_.size());
+        blocks_[to].in.push_back(edges_.size());
+        edges_.push_back({from, to, taken});
+    };
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        const Instruction *last = blocks_[b].code.empty() ? nullptr : &blocks_[b].code.back();
+        if (last != nullptr && last->op == Opcode::kJump) {
+            add_edge(b, label_block.at(last->imm), true);
+            continue;
+        }
+        if (b + 1 < blocks_.size()) {
+            add_edge(b, b + 1, false);
+        }
+        if (last != nullptr && last->op == Opcode::kBranch) {
+            add_edge(b, label_block.at(last->imm), true);
+        }
+    }
+
+    std::vector<bool> reachable(blocks_.size(), false);
+    std::vector<size_t> stack = {0};
+    reachable[0] = true;
+    while (!stack.empty()) {
+        const size_t kBlock = stack.back();
+        stack.pop_back();
+        for (size_t e : blocks_[kBlock].out) {
+            if (!reachable[edges_[e].to]) {
+                reachable[edges_[e].to] = true;
+                stack.push_back(edges_[e].to);
+            }
+        }
+    }
+    remove_unreachable(reachable);
+}
+
+void SSAOptimizer::remove_edge(size_t edge) {
+    auto &to = blocks_[edges_[edge].to];
+    const auto kIn = std::find(to.in.begin(), to.in.end(), edge);
+    const auto kPosition = kIn - to.in.begin();
+    to.in.erase(kIn);
+    for (auto &phi : to.phis) {
+        phi.args.erase(phi.args.begin() + kPosition);
+    }
+    auto &from = blocks_[edges_[edge].from];
+    from.out.erase(std::find(from.out.begin(), from.out.end(), edge));
+}
+
+void SSAOptimizer::remove_unreachable(const std::vector<bool> &reachable) {
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        if (reachable[b] || !blocks_[b].reachable) {
+            continue;
+        }
+        // A loop on the block itself is both an in-edge and an out-edge.
+        std::vector<size_t> edges = blocks_[b].out;
+        edges.insert(edges.end(), blocks_[b].in.begin(), blocks_[b].in.end());
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        for (size_t e : edges) {
+            remove_edge(e);
+        }
+        blocks_[b].code.clear();
+        blocks_[b].phis.clear();
+        blocks_[b].reachable = false;
+        ++statistics_.blocks;
+    }
+}
+
+// Cooper, Harvey and Kennedy's iteration over reverse postorder.
+void SSAOptimizer::compute_dominators() {
+    std::vector<size_t> postorder;
+    std::vector<bool> visited(blocks_.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack = {{0, 0}};
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto &[block, next] = stack.back();
+        if (next < blocks_[block].out.size()) {
+            const size_t kTo = edges_[blocks_[block].out[next++]].to;
+            if (!visited[kTo]) {
+                visited[kTo] = true;
+                stack.emplace_back(kTo, 0);
+            }
+            continue;
+        }
+        postorder.push_back(block);
+        stack.pop_back();
+    }
+    std::vector<size_t> order(blocks_.size(), kNone);
+    for (size_t i = 0; i < postorder.size(); ++i) {
+        order[postorder[i]] = i;
+    }
+    for (auto &block : blocks_) {
+        block.idom = kNone;
+        block.children.clear();
+    }
+    blocks_[0].idom = 0;
+    const auto intersect = [&](size_t lhs, size_t rhs) {
+        while (lhs != rhs) {
+            while (order[lhs] < order[rhs]) {
+                lhs = blocks_[lhs].idom;
+            }
+            while (order[rhs] < order[lhs]) {
+                rhs = blocks_[rhs].idom;
+            }
+        }
+        return lhs;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = postorder.size() - 1; i-- > 0;) {
+            const size_t kBlock = postorder[i];
+            size_t idom = kNone;
+            for (size_t e : blocks_[kBlock].in) {
+                const size_t kFrom = edges_[e].from;
+                if (blocks_[kFrom].idom != kNone) {
+                    idom = idom == kNone ? kFrom : intersect(kFrom, idom);
+                }
+            }
+            if (idom != blocks_[kBlock].idom) {
+                blocks_[kBlock].idom = idom;
+                changed = true;
+            }
+        }
+    }
+    for (size_t i = postorder.size() - 1; i-- > 0;) {
+        blocks_[blocks_[postorder[i]].idom].children.push_back(postorder[i]);
+    }
+}
+
+// Phis go on the iterated dominance frontier of every block storing to a variable, then a walk
+// of the dominator tree keeps each variable's current value on a stack: stores push, loads are
+// replaced by the top and every edge leaving a block gives the phis it enters their argument.
+void SSAOptimizer::construct_ssa() {
+    const size_t kBlocks = blocks_.size();
+    std::vector<std::vector<size_t>> frontier(kBlocks);
+    for (size_t b = 0; b < kBlocks; ++b) {
+        if (blocks_[b].in.size() < 2) {
+            continue;
+        }
+        for (size_t e : blocks_[b].in) {
+            for (size_t runner = edges_[e].from; runner != blocks_[b].idom;
+                 runner = blocks_[runner].idom) {
+                if (frontier[runner].empty() || frontier[runner].back() != b) {
+                    frontier[runner].push_back(b);
+                }
+            }
+        }
+    }
+
+    std::map<Variable, size_t> variable_id;
+    std::vector<std::vector<size_t>> stores;
+    for (size_t b = 0; b < kBlocks; ++b) {
+        for (const auto &in : blocks_[b].code) {
+            const auto kVariable = variable_of(in);
+            if (!kVariable) {
+                continue;
+            }
+            const auto [it, inserted] = variable_id.emplace(*kVariable, stores.size());
+            if (inserted) {
+                stores.emplace_back();
+            }
+            auto &blocks = stores[it->second];
+            if (!is_load(in) && (blocks.empty() || blocks.back() != b)) {
+                blocks.push_back(b);
+            }
+        }
+    }
+
+    // Globals start out zero; so do locals here, which is as good as any value.
+    std::vector<std::vector<VReg>> current(stores.size());
+    for (auto &values : current) {
+        Instruction zero;
+        zero.op = Opcode::kConst;
+        zero.dst = vreg_new();
+        blocks_[0].code.push_back(zero);
+        values.push_back(zero.dst);
+    }
+
+    std::vector<std::vector<size_t>> phi_variables(kBlocks);
+    std::vector<size_t> has_phi(kBlocks, kNone), queued(kBlocks, kNone);
+    for (size_t id = 0; id < stores.size(); ++id) {
+        std::vector<size_t> worklist = stores[id];
+        for (size_t b : worklist) {
+            queued[b] = id;
+        }
+        while (!worklist.empty()) {
+            const size_t kBlock = worklist.back();
+            worklist.pop_back();
+            for (size_t b : frontier[kBlock]) {
+                if (has_phi[b] == id) {
+                    continue;
+                }
+                has_phi[b] = id;
+                blocks_[b].phis.push_back(
+                        {vreg_new(), std::vector<VReg>(blocks_[b].in.size(), kNoVReg)});
+                phi_variables[b].push_back(id);
+                ++statistics_.phis;
+                if (queued[b] != id) {
+                    queued[b] = id;
+                    worklist.push_back(b);
+                }
+            }
+        }
+    }
+
+    struct Frame {
+        size_t block;
+        size_t next_child;
+        std::vector<size_t> pushed;
+    };
+    std::vector<Frame> stack;
+    const auto enter = [&](size_t b) {
+        Frame frame{b, 0, {}};
+        auto &block = blocks_[b];
+        for (size_t j = 0; j < block.phis.size(); ++j) {
+            current[phi_variables[b][j]].push_back(block.phis[j].dst);
+            frame.pushed.push_back(phi_variables[b][j]);
+        }
+        std::vector<Instruction> code;
+        code.reserve(block.code.size());
+        for (auto in : block.code) {
+            for (VReg *v : {&in.a, &in.b, &in.c}) {
+                *v = resolve(*v);
+            }
+            const auto kVariable = variable_of(in);
+            if (!kVariable) {
+                code.push_back(in);
+                continue;
+            }
+            const size_t kId = variable_id.at(*kVariable);
+            if (is_load(in)) {
+                alias_[in.dst] = current[kId].back();
+            } else {
+                current[kId].push_back(in.a);
+                frame.pushed.push_back(kId);
+            }
+        }
+        block.code = std::move(code);
+        for (size_t e : block.out) {
+            auto &successor = blocks_[edges_[e].to];
+            const size_t kPosition =
+                    std::find(successor.in.begin(), successor.in.end(), e) - successor.in.begin();
+            for (size_t j = 0; j < successor.phis.size(); ++j) {
+                successor.phis[j].args[kPosition] =
+                        current[phi_variables[edges_[e].to][j]].back();
+            }
+        }
+        stack.push_back(std::move(frame));
+    };
+    enter(0);
+    while (!stack.empty()) {
+        auto &frame = stack.back();
+        const auto &children = blocks_[frame.block].children;
+        if (frame.next_child < children.size()) {
+            enter(children[frame.next_child++]);
+            continue;
+        }
+        for (size_t id : frame.pushed) {
+            current[id].pop_back();
+        }
+        stack.pop_back();
+    }
+}
+
+// Wegman and Zadeck: values start unknown and only move down the lattice, edges start
+// unexecuted, and a block is evaluated once one of its edges is executed.
+void SSAOptimizer::propagate_constants() {
+    const size_t kBlocks = blocks_.size();
+    std::vector<Value> values(function_->num_vregs);
+    struct Use {
+        size_t block;
+        size_t index;
+        bool phi;
+    };
+    std::vector<std::vector<Use>> uses(function_->num_vregs);
+    for (size_t b = 0; b < kBlocks; ++b) {
+        for (size_t j = 0; j < blocks_[b].phis.size(); ++j) {
+            for (VReg v : blocks_[b].phis[j].args) {
+                uses[v].push_back({b, j, true});
+            }
+        }
+        for (size_t i = 0; i < blocks_[b].code.size(); ++i) {
+            const auto &in = blocks_[b].code[i];
+            for (VReg v : {in.a, in.b, in.c}) {
+                if (v != kNoVReg) {
+                    uses[v].push_back({b, i, false});
+                }
+            }
+        }
+    }
+
+    std::vector<bool> executable(edges_.size(), false), visited(kBlocks, false);
+    std::vector<size_t> flow;
+    std::vector<VReg> changed;
+    const auto operand = [&values](VReg v, int64_t constant) {
+        return v == kNoVReg ? Value{Lattice::kConstant, constant} : values[v];
+    };
+    const auto lower = [&](VReg v, const Value &value) {
+        const Value kLowered = meet(values[v], value);
+        if (!(kLowered == values[v])) {
+            values[v] = kLowered;
+            changed.push_back(v);
+        }
+    };
+    const auto execute = [&](size_t e) {
+        if (!executable[e]) {
+            executable[e] = true;
+            flow.push_back(e);
+        }
+    };
+    const auto evaluate = [&](const Instruction &in) -> Value {
+        switch (in.op) {
+        case Opcode::kConst:
+            return {Lattice::kConstant, in.imm};
+        case Opcode::kMove:
+            return values[in.a];
+        case Opcode::kAdd:
+        case Opcode::kSub:
+        case Opcode::kMul:
+        case Opcode::kDiv:
+        case Opcode::kCompare: {
+            const Value kLeft = values[in.a], kRight = operand(in.b, in.constant);
+            if (kLeft.lattice == Lattice::kVarying || kRight.lattice == Lattice::kVarying) {
+                return {Lattice::kVarying, 0};
+            }
+            if (kLeft.lattice == Lattice::kUnknown || kRight.lattice == Lattice::kUnknown) {
+                return {};
+            }
+            const int64_t kL = kLeft.constant, kR = kRight.constant;
+            switch (in.op) {
+            case Opcode::kAdd:
+                return {Lattice::kConstant, arith::Add(kL, kR)};
+            case Opcode::kSub:
+                return {Lattice::kConstant, arith::Sub(kL, kR)};
+            case Opcode::kMul:
+                return {Lattice::kConstant, arith::Mul(kL, kR)};
+            case Opcode::kDiv:
+                // A division that faults is left to fault when it runs.
+                if (arith::DivFaults(kL, kR)) {
+                    return {Lattice::kVarying, 0};
+                }
+                return {Lattice::kConstant, arith::Div(kL, kR)};
+            default:
+                return {Lattice::kConstant, holds(in.cond, kL, kR) ? 1 : 0};
+            }
+        }
+        case Opcode::kSelect: {
+            const Value kCondition = values[in.a];
+            if (kCondition.lattice == Lattice::kConstant) {
+                return values[kCondition.constant != 0 ? in.b : in.c];
+            }
+            if (kCondition.lattice == Lattice::kUnknown) {
+                return {};
+            }
+            return meet(values[in.b], values[in.c]);
+        }
+        default:
+            return {Lattice::kVarying, 0};
+        }
+    };
+    const auto visit_phi = [&](size_t b, size_t j) {
+        const auto &block = blocks_[b];
+        Value value;
+        for (size_t k = 0; k < block.in.size(); ++k) {
+            if (executable[block.in[k]]) {
+                value = meet(value, values[block.phis[j].args[k]]);
+            }
+        }
+        lower(block.phis[j].dst, value);
+    };
+    const auto visit_instruction = [&](size_t b, size_t i) {
+        const auto &block = blocks_[b];
+        const auto &in = block.code[i];
+        if (in.op == Opcode::kBranch) {
+            const Value kLeft = values[in.a], kRight = operand(in.b, in.constant);
+            if (kLeft.lattice == Lattice::kUnknown || kRight.lattice == Lattice::kUnknown) {
+                return;
+            }
+            const bool kDecided =
+                    kLeft.lattice == Lattice::kConstant && kRight.lattice == Lattice::kConstant;
+            const bool kTaken = kDecided && holds(in.cond, kLeft.constant, kRight.constant);
+            for (size_t e : block.out) {
+                if (!kDecided || edges_[e].taken == kTaken) {
+                    execute(e);
+                }
+            }
+        } else if (in.op == Opcode::kJump) {
+            for (size_t e : block.out) {
+                execute(e);
+            }
+        } else if (in.dst != kNoVReg) {
+            lower(in.dst, evaluate(in));
+        }
+    };
+    const auto visit_block = [&](size_t b) {
+        visited[b] = true;
+        const auto &block = blocks_[b];
+        for (size_t j = 0; j < block.phis.size(); ++j) {
+            visit_phi(b, j);
+        }
+        for (size_t i = 0; i < block.code.size(); ++i) {
+            visit_instruction(b, i);
+        }
+        if (block.code.empty() || !is_terminator(block.code.back())) {
+            for (size_t e : block.out) {
+                execute(e);
+            }
+        }
+    };
+
+    visit_block(0);
+    while (!flow.empty() || !changed.empty()) {
+        if (!flow.empty()) {
+            const size_t kEdge = flow.back();
+            flow.pop_back();
+            const size_t kTo = edges_[kEdge].to;
+            if (!visited[kTo]) {
+                visit_block(kTo);
+            } else {
+                for (size_t j = 0; j < blocks_[kTo].phis.size(); ++j) {
+                    visit_phi(kTo, j);
+                }
+            }
+            continue;
+        }
+        const VReg kVReg = changed.back();
+        changed.pop_back();
+        for (const auto &use : uses[kVReg]) {
+            if (!visited[use.block]) {
+                continue;
+            }
+            if (use.phi) {
+                visit_phi(use.block, use.index);
+            } else {
+                visit_instruction(use.block, use.index);
+            }
+        }
+    }
+
+    // Edges never executed go, and the branches they leave become jumps or nothing.
+    for (size_t b = 0; b < kBlocks; ++b) {
+        if (!visited[b]) {
+            continue;
+        }
+        auto &block = blocks_[b];
+        const std::vector<size_t> kOut = block.out;
+        for (size_t e : kOut) {
+            if (!executable[e]) {
+                remove_edge(e);
+            }
+        }
+        if (block.out.size() == kOut.size() || block.out.size() != 1
+            || block.code.back().op != Opcode::kBranch) {
+            continue;
+        }
+        if (edges_[block.out.front()].taken) {
+            block.code.back() = make_control(Opcode::kJump, block.code.back().imm);
+        } else {
+            block.code.pop_back();
+        }
+        ++statistics_.branches;
+    }
+    remove_unreachable(visited);
+
+    for (auto &block : blocks_) {
+        if (!block.reachable) {
+            continue;
+        }
+        std::vector<Instruction> constants;
+        std::vector<Phi> phis;
+        for (auto &phi : block.phis) {
+            if (values[phi.dst].lattice == Lattice::kConstant) {
+                Instruction in;
+                in.op = Opcode::kConst;
+                in.dst = phi.dst;
+                in.imm = values[phi.dst].constant;
+                constants.push_back(in);
+            } else {
+                phis.push_back(std::move(phi));
+            }
+        }
+        block.phis = std::move(phis);
+        for (auto &in : block.code) {
+            if (in.dst != kNoVReg && in.op != Opcode::kConst
+                && values[in.dst].lattice == Lattice::kConstant) {
+                Instruction folded;
+                folded.op = Opcode::kConst;
+                folded.dst = in.dst;
+                folded.imm = values[in.dst].constant;
+                in = folded;
+                ++statistics_.constants;
+            }
+        }
+        statistics_.constants += constants.size();
+        const size_t kStart = !block.code.empty() && block.code[0].op == Opcode::kLabel ? 1 : 0;
+        block.code.insert(block.code.begin() + kStart, constants.begin(), constants.end());
+    }
+}
+
+// Replaces phis whose arguments are all one value (or the phi itself) by that value, until none
+// is left, and then every operand by what it was replaced with.
+void SSAOptimizer::remove_trivial_phis() {
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto &block : blocks_) {
+            std::vector<Phi> phis;
+            for (auto &phi : block.phis) {
+                VReg same = kNoVReg;
+                bool trivial = true;
+                for (VReg &arg : phi.args) {
+                    arg = resolve(arg);
+                    if (arg == phi.dst || arg == same) {
+                        continue;
+                    }
+                    trivial = trivial && same == kNoVReg;
+                    same = arg;
+                }
+                if (trivial && same != kNoVReg) {
+                    alias_[phi.dst] = same;
+                    ++statistics_.redundant;
+                    changed = true;
+                } else {
+                    phis.push_back(std::move(phi));
+                }
+            }
+            block.phis = std::move(phis);
+        }
+    }
+    for (auto &block : blocks_) {
+        for (auto &phi : block.phis) {
+            for (VReg &arg : phi.args) {
+                arg = resolve(arg);
+            }
+        }
+        for (auto &in : block.code) {
+            for (VReg *v : {&in.a, &in.b, &in.c}) {
+                *v = resolve(*v);
+            }
+        }
+    }
+}
+
+// Dominator-based value numbering: walking the dominator tree, an operation on the same operands
+// as one in a dominating block reuses its value. Constants are left alone: they are cheaper to
+// materialize again than to keep in a register.
+void SSAOptimizer::number_values() {
+    using Key = std::tuple<Opcode, Condition, VReg, VReg, VReg, int64_t>;
+    std::map<Key, VReg> available;
+    struct Frame {
+        size_t block;
+        size_t next_child;
+        std::vector<Key> added;
+    };
+    std::vector<Frame> stack;
+    const auto enter = [&](size_t b) {
+        Frame frame{b, 0, {}};
+        auto &block = blocks_[b];
+        std::vector<Instruction> code;
+        code.reserve(block.code.size());
+        for (auto in : block.code) {
+            for (VReg *v : {&in.a, &in.b, &in.c}) {
+                *v = resolve(*v);
+            }
+            if (in.op == Opcode::kMove || (in.op == Opcode::kSelect && in.b == in.c)) {
+                alias_[in.dst] = in.op == Opcode::kMove ? in.a : in.b;
+                ++statistics_.redundant;
+                continue;
+            }
+            switch (in.op) {
+            case Opcode::kAdd:
+            case Opcode::kMul:
+                if (in.b != kNoVReg && in.b < in.a) {
+                    std::swap(in.a, in.b);
+                }
+                break;
+            case Opcode::kCompare:
+                if (in.b != kNoVReg && in.b < in.a) {
+                    std::swap(in.a, in.b);
+                    in.cond = Swap(in.cond);
+                }
+                break;
+            case Opcode::kSub:
+            case Opcode::kDiv:
+            case Opcode::kSelect:
+                break;
+            default:
+                code.push_back(in);
+                continue;
+            }
+            const Key kKey{in.op, in.cond, in.a, in.b, in.c, in.constant};
+            const auto [it, inserted] = available.emplace(kKey, in.dst);
+            if (!inserted) {
+                alias_[in.dst] = it->second;
+                ++statistics_.redundant;
+                continue;
+            }
+            frame.added.push_back(kKey);
+            code.push_back(in);
+        }
+        block.code = std::move(code);
+        stack.push_back(std::move(frame));
+    };
+    enter(0);
+    while (!stack.empty()) {
+        auto &frame = stack.back();
+        const auto &children = blocks_[frame.block].children;
+        if (frame.next_child < children.size()) {
+            enter(children[frame.next_child++]);
+            continue;
+        }
+        for (const auto &key : frame.added) {
+            available.erase(key);
+        }
+        stack.pop_back();
+    }
+}
+
+// Marks what printing, control flow and possibly faulting divisions need, and removes the rest.
+void SSAOptimizer::remove_dead() {
+    const size_t kVRegs = function_->num_vregs;
+    std::vector<bool> constant(kVRegs, false);
+    std::vector<int64_t> value(kVRegs, 0);
+    struct Def {
+        size_t block = kNone;
+        size_t index = 0;
+        bool phi = false;
+    };
+    std::vector<Def> defs(kVRegs);
+    for (size_t b = 0; b < blocks_.size(); ++b) {
+        for (size_t j = 0; j < blocks_[b].phis.size(); ++j) {
+            defs[blocks_[b].phis[j].dst] = {b, j, true};
+        }
+        for (size_t i = 0; i < blocks_[b].code.size(); ++i) {
+            const auto &in = blocks_[b].code[i];
+            if (in.dst != kNoVReg) {
+                defs[in.dst] = {b, i, false};
+                if (in.op == Opcode::kConst) {
+                    constant[in.dst] = true;
+                    value[in.dst] = in.imm;
+                }
+            }
+        }
+    }
+    const auto removable = [&](const Instruction &in) {
+        if (in.dst == kNoVReg) {
+            return false;
+        }
+        if (in.op != Opcode::kDiv) {
+            return is_pure(in);
+        }
+        if (in.b != kNoVReg && !constant[in.b]) {
+            return false;
+        }
+        const int64_t kDivisor = in.b != kNoVReg ? value[in.b] : in.constant;
+        return kDivisor != 0 && kDivisor != -1;
+    };
+
+    std::vector<bool> live(kVRegs, false);
+    std::vector<VReg> worklist;
+    const auto use = [&](VReg v) {
+        if (v != kNoVReg && !live[v]) {
+            live[v] = true;
+            worklist.push_back(v);
+        }
+    };
+    for (const auto &block : blocks_) {
+        for (const auto &in : block.code) {
+            if (!removable(in)) {
+                use(in.a);
+                use(in.b);
+                use(in.c);
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        const Def kDef = defs[worklist.back()];
+        worklist.pop_back();
+        if (kDef.block == kNone) {
+            continue;
+        }
+        const auto &block = blocks_[kDef.block];
+        if (kDef.phi) {
+            for (VReg v : block.phis[kDef.index].args) {
+                use(v);
+            }
+        } else {
+            const auto &in = block.code[kDef.index];
+            use(in.a);
+            use(in.b);
+            use(in.c);
+        }
+    }
+
+    for (auto &block : blocks_) {
+        const size_t kBefore = block.phis.size() + block.code.size();
+        block.phis.erase(
+                std::remove_if(
+                        block.phis.begin(),
+                        block.phis.end(),
+                        [&live](const Phi &phi) { return !live[phi.dst]; }),
+                block.phis.end());
+        block.code.erase(
+                std::remove_if(
+                        block.code.begin(),
+                        block.code.end(),
+                        [&](const Instruction &in) { return removable(in) && !live[in.dst]; }),
+                block.code.end());
+        statistics_.dead += kBefore - block.phis.size() - block.code.size();
+    }
+}
+
+// Coalesces each phi with those of its arguments whose live ranges do not interfere with the
+// ones already coalesced with it, so that they share one virtual register and the copy between
+// them disappears. Two values interfere when one is live right after the other is defined;
+// liveness is only found for the values involved, walking back from their uses up to their
+// definition. Copies on loop back edges run on every iteration, so those arguments are tried
+// first. Constants are left out: an edge can set the phi from an immediate just as cheaply,
+// and the constant keeps its single definition for select_immediates.
+std::vector<VReg> SSAOptimizer::coalesce_phis() {
+    const size_t kBlocks = blocks_.size();
+    std::vector<VReg> representative(function_->num_vregs);
+    std::iota(representative.begin(), representative.end(), VReg{0});
+    std::vector<bool> constant(function_->num_vregs, false);
+    for (const auto &block : blocks_) {
+        for (const auto &in : block.code) {
+            if (in.op == Opcode::kConst) {
+                constant[in.dst] = true;
+            }
+        }
+    }
+
+    // The phis and their other arguments, with where they are defined and used. Positions in
+    // a block count the phis as 0 and instruction i as i + 1.
+    struct Site {
+        size_t block;
+        size_t position;
+    };
+    std::vector<size_t> candidate(function_->num_vregs, kNone);
+    std::vector<Site> defs;
+    std::vector<std::vector<Site>> uses;
+    std::vector<std::vector<size_t>> live_out;
+    const auto add_candidate = [&](VReg v) {
+        if (candidate[v] == kNone) {
+            candidate[v] = defs.size();
+            defs.push_back({kNone, 0});
+            uses.emplace_back();
+            live_out.emplace_back();
+        }
+    };
+    std::vector<std::tuple<size_t, size_t, size_t>> pairs;
+    for (size_t b = 0; b < kBlocks; ++b) {
+        const auto &block = blocks_[b];
+        for (size_t j = 0; j < block.phis.size(); ++j) {
+            add_candidate(block.phis[j].dst);
+            for (size_t k = 0; k < block.in.size(); ++k) {
+                const VReg kArg = block.phis[j].args[k];
+                if (!constant[kArg] && kArg != block.phis[j].dst) {
+                    add_candidate(kArg);
+                    pairs.emplace_back(b, j, k);
+                }
+            }
+        }
+    }
+    if (pairs.empty()) {
+        return representative;
+    }
+    for (size_t b = 0; b < kBlocks; ++b) {
+        const auto &block = blocks_[b];
+        for (const auto &phi : block.phis) {
+            defs[candidate[phi.dst]] = {b, 0};
+        }
+        for (size_t i = 0; i < block.code.size(); ++i) {
+            const auto &in = block.code[i];
+            if (in.dst != kNoVReg && candidate[in.dst] != kNone) {
+                defs[candidate[in.dst]] = {b, i + 1};
+            }
+            for (VReg v : {in.a, in.b, in.c}) {
+                if (v != kNoVReg && candidate[v] != kNone) {
+                    uses[candidate[v]].push_back({b, i + 1});
+                }
+            }
+        }
+    }
+
+    // A phi argument is live out of the predecessor its edge leaves, not into the phi's block.
+    std::vector<std::vector<size_t>> arg_blocks(defs.size());
+    for (size_t b = 0; b < kBlocks; ++b) {
+        for (const auto &phi : blocks_[b].phis) {
+            for (size_t k = 0; k < phi.args.size(); ++k) {
+                if (candidate[phi.args[k]] != kNone) {
+                    arg_blocks[candidate[phi.args[k]]].push_back(edges_[blocks_[b].in[k]].from);
+                }
+            }
+        }
+    }
+    std::vector<size_t> live_in(kBlocks, kNone), out_marked(kBlocks, kNone);
+    for (size_t id = 0; id < defs.size(); ++id) {
+        const size_t kDefBlock = defs[id].block;
+        std::vector<size_t> worklist;
+        const auto mark_in = [&](size_t b) {
+            if (b != kDefBlock && live_in[b] != id) {
+                live_in[b] = id;
+                worklist.push_back(b);
+            }
+        };
+        const auto mark_out = [&](size_t b) {
+            if (out_marked[b] != id) {
+                out_marked[b] = id;
+                live_out[id].push_back(b);
+            }
+            mark_in(b);
+        };
+        for (const auto &use : uses[id]) {
+            mark_in(use.block);
+        }
+        for (size_t b : arg_blocks[id]) {
+            mark_out(b);
+        }
+        while (!worklist.empty()) {
+            const size_t kLive = worklist.back();
+            worklist.pop_back();
+            for (size_t e : blocks_[kLive].in) {
+                mark_out(edges_[e].from);
+            }
+        }
+        std::sort(live_out[id].begin(), live_out[id].end());
+    }
+
+    // Whether candidate x is live right after `site`.
+    const auto live_after = [&](size_t x, const Site &site) {
+        if (defs[x].block == site.block && defs[x].position > site.position) {
+            return false;
+        }
+        if (std::binary_search(live_out[x].begin(), live_out[x].end(), site.block)) {
+            return true;
+        }
+        return std::any_of(uses[x].begin(), uses[x].end(), [&site](const Site &use) {
+            return use.block == site.block && use.position > site.position;
+        });
+    };
+    std::vector<size_t> leader(defs.size());
+    std::iota(leader.begin(), leader.end(), size_t{0});
+    std::vector<std::vector<size_t>> members(defs.size());
+    for (size_t id = 0; id < defs.size(); ++id) {
+        members[id].push_back(id);
+    }
+    const auto interfere = [&](size_t lhs, size_t rhs) {
+        for (size_t x : members[lhs]) {
+            for (size_t y : members[rhs]) {
+                if (live_after(x, defs[y]) || live_after(y, defs[x])) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::stable_partition(pairs.begin(), pairs.end(), [this](const auto &pair) {
+        const auto &[kBlock, kIndex, kEdge] = pair;
+        return edges_[blocks_[kBlock].in[kEdge]].from >= kBlock;
+    });
+    for (const auto &[kBlock, kIndex, kEdge] : pairs) {
+        const auto &phi = blocks_[kBlock].phis[kIndex];
+        const size_t kPhi = leader[candidate[phi.dst]];
+        const size_t kArg = leader[candidate[phi.args[kEdge]]];
+        if (kPhi == kArg || interfere(kPhi, kArg)) {
+            continue;
+        }
+        for (size_t id : members[kArg]) {
+            leader[id] = kPhi;
+        }
+        members[kPhi].insert(members[kPhi].end(), members[kArg].begin(), members[kArg].end());
+        members[kArg].clear();
+        ++statistics_.coalesced;
+    }
+
+    std::vector<VReg> value_of(defs.size());
+    for (VReg v = 0; v < candidate.size(); ++v) {
+        if (candidate[v] != kNone) {
+            value_of[candidate[v]] = v;
+        }
+    }
+    for (VReg v = 0; v < candidate.size(); ++v) {
+        if (candidate[v] != kNone) {
+            representative[v] = value_of[leader[candidate[v]]];
+        }
+    }
+    return representative;
+}
+
+// Orders copies that happen at once: a copy goes when no other still reads its destination, and
+// a cycle of them is broken by saving one destination in a temporary first.
+std::vector<Instruction> SSAOptimizer::sequence_copies(std::vector<std::pair<VReg, VReg>> copies) {
+    std::vector<Instruction> code;
+    while (!copies.empty()) {
+        const auto kReady = std::find_if(copies.begin(), copies.end(), [&copies](const auto &copy) {
+            return std::none_of(copies.begin(), copies.end(), [&copy](const auto &other) {
+                return other.second == copy.first;
+            });
+        });
+        if (kReady != copies.end()) {
+            code.push_back(make_move(kReady->first, kReady->second));
+            copies.erase(kReady);
+            continue;
+        }
+        const VReg kSaved = copies.front().first;
+        const VReg kTemporary = vreg_new();
+        code.push_back(make_move(kTemporary, kSaved));
+        for (auto &copy : copies) {
+            if (copy.second == kSaved) {
+                copy.second = kTemporary;
+            }
+        }
+    }
+    return code;
+}
+
+// Out of SSA, the phis are coalesced with what they can, every value is renamed to its class,
+// and each edge into a block with phis gets the copies of its arguments that are left, on that
+// edge only. An edge is critical whenever it leaves a branch, since a block with phis has more
+// than one way in: the fall-through copies go right after the branch, and the taken ones to a
+// block of their own after the code, which the branch is retargeted to and which jumps on.
+void SSAOptimizer::leave_ssa() {
+    auto &function = *function_;
+    int64_t next_label = 0;
+    for (const auto &in : function.code) {
+        if (in.op == Opcode::kLabel || is_terminator(in)) {
+            next_label = std::max(next_label, in.imm + 1);
+        }
+    }
+
+    const auto kRepresentative = coalesce_phis();
+    std::vector<bool> constant(function.num_vregs, false);
+    std::vector<int64_t> value(function.num_vregs, 0);
+    for (auto &block : blocks_) {
+        for (auto &in : block.code) {
+            if (in.op == Opcode::kConst) {
+                constant[in.dst] = true;
+                value[in.dst] = in.imm;
+            }
+            for (VReg *v : {&in.dst, &in.a, &in.b, &in.c}) {
+                if (*v != kNoVReg) {
+                    *v = kRepresentative[*v];
+                }
+            }
+        }
+    }
+
+    struct Split {
+        int64_t label;
+        std::vector<Instruction> copies;
+        int64_t target;
+    };
+    std::vector<Split> splits;
+    const size_t kBlocks = blocks_.size();
+    std::vector<std::vector<Instruction>> before_jump(kBlocks), after_branch(kBlocks);
+    for (size_t b = 0; b < kBlocks; ++b) {
+        const auto &block = blocks_[b];
+        for (size_t k = 0; k < block.in.size() && !block.phis.empty(); ++k) {
+            std::vector<std::pair<VReg, VReg>> moves;
+            std::vector<Instruction> constants;
+            for (const auto &phi : block.phis) {
+                const VReg kDst = kRepresentative[phi.dst];
+                const VReg kArg = phi.args[k];
+                if (constant[kArg]) {
+                    Instruction in;
+                    in.op = Opcode::kConst;
+                    in.dst = kDst;
+                    in.imm = value[kArg];
+                    constants.push_back(in);
+                } else if (kRepresentative[kArg] != kDst) {
+                    moves.emplace_back(kDst, kRepresentative[kArg]);
+                }
+            }
+            // Constants read nothing, so they go after every move has read its source.
+            auto copies = sequence_copies(std::move(moves));
+            copies.insert(copies.end(), constants.begin(), constants.end());
+            if (copies.empty()) {
+                continue;
+            }
+            statistics_.copies += copies.size();
+            const auto &edge = edges_[block.in[k]];
+            auto &from = blocks_[edge.from];
+            if (from.out.size() < 2) {
+                auto &list = before_jump[edge.from];
+                list.insert(list.end(), copies.begin(), copies.end());
+            } else if (!edge.taken) {
+                auto &list = after_branch[edge.from];
+                list.insert(list.end(), copies.begin(), copies.end());
+            } else {
+                from.code.back().imm = next_label;
+                splits.push_back({next_label++, std::move(copies), block.code.front().imm});
+            }
+        }
+    }
+
+    std::vector<Instruction> code;
+    for (size_t b = 0; b < kBlocks; ++b) {
+        const auto &block = blocks_[b];
+        if (!block.reachable) {
+            continue;
+        }
+        const bool kEndsInJump = !block.code.empty() && is_terminator(block.code.back());
+        const size_t kBody = block.code.size() - (kEndsInJump ? 1 : 0);
+        code.insert(code.end(), block.code.begin(), block.code.begin() + kBody);
+        code.insert(code.end(), before_jump[b].begin(), before_jump[b].end());
+        if (kEndsInJump) {
+            code.push_back(block.code.back());
+        }
+        code.insert(code.end(), after_branch[b].begin(), after_branch[b].end());
+    }
+    if (!splits.empty()) {
+        const int64_t kDone = next_label++;
+        code.push_back(make_control(Opcode::kJump, kDone));
+        for (auto &split : splits) {
+            code.push_back(make_control(Opcode::kLabel, split.label));
+            code.insert(code.end(), split.copies.begin(), split.copies.end());
+            code.push_back(make_control(Opcode::kJump, split.target));
+        }
+        code.push_back(make_control(Opcode::kLabel, kDone));
+    }
+    function.code = std::move(code);
+}
+}  // namespace ir
+}  // namespace my_cpp
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ir.hpp"
+// Standard includes
+// C++ Standard
+#include <utility>
+#include <vector>
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+namespace ir {
+// Optimizes a function on its control-flow graph in SSA form. The linear code is cut into basic
+// blocks, and every variable becomes values: each store defines a new one and phis merge them
+// where paths meet, on the iterated dominance frontiers. Nothing outside main reads the
+// variables, so no loads or stores survive. Sparse conditional constant propagation then folds
+// constant values and the branches they decide, dominator-based value numbering drops values
+// computed before, and unused ones are removed. Leaving SSA coalesces each phi with the
+// arguments whose live ranges do not interfere with its own, and turns the rest into copies on
+// the edges into its block, splitting the critical ones.
+class SSAOptimizer {
+public:
+    struct Statistics {
+        size_t phis = 0;       // placed while renaming the variables
+        size_t constants = 0;  // values found constant and folded
+        size_t branches = 0;   // branches found to go one way
+        size_t blocks = 0;     // blocks found unreachable
+        size_t redundant = 0;  // values found computed before, and copies
+        size_t dead = 0;       // instructions and phis whose values went unused
+        size_t coalesced = 0;  // phi arguments given the phi's register
+        size_t copies = 0;     // copies left on the edges into phi blocks
+    };
+
+    // Leaves the function as it is and returns false unless every virtual register is defined
+    // once, as IRBuilder makes them.
+    bool Run(Function &function);
+    const Statistics &GetStatistics() const;
+
+private:
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+
+    struct Phi {
+        VReg dst;
+        std::vector<VReg> args;  // in the order of the block's in-edges
+    };
+    struct Block {
+        std::vector<Instruction> code;  // a leading label and the jump or branch included
+        std::vector<Phi> phis;
+        std::vector<size_t> in;   // edges, by index
+        std::vector<size_t> out;  // edges; for a branch, the fall-through edge first
+        bool reachable = true;
+        size_t idom = kNone;
+        std::vector<size_t> children;
+    };
+    struct Edge {
+        size_t from;
+        size_t to;
+        bool taken;  // the branch or jump goes here, rather than falling through
+    };
+
+    Function *function_ = nullptr;
+    std::vector<Block> blocks_;
+    std::vector<Edge> edges_;
+    // What every value has been replaced with; itself if it has not.
+    std::vector<VReg> alias_;
+    Statistics statistics_;
+
+    VReg vreg_new();
+    VReg resolve(VReg vreg) const;
+    void build_blocks();
+    void remove_edge(size_t edge);
+    void remove_unreachable(const std::vector<bool> &reachable);
+    void compute_dominators();
+    void construct_ssa();
+    void propagate_constants();
+    void number_values();
+    void remove_trivial_phis();
+    void remove_dead();
+    // The virtual register each value is renamed to when leaving SSA.
+    std::vector<VReg> coalesce_phis();
+    std::vector<Instruction> sequence_copies(std::vector<std::pair<VReg, VReg>> copies);
+    void leave_ssa();
+};
+}  // namespace ir
+}  // namespace my_cpp
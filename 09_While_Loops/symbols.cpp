@@ -2,15 +2,181 @@
 
 // Standard includes
 // C++ Standard
+#include <algorithm>
 #include <stdexcept>
 // C Standard
+#include <cstdint>
 
 namespace my_cpp {
 
-SymbolTableEntry::SymbolTableEntry(const std::string &name) : name_(name) {
+SymbolTableEntry::SymbolTableEntry(size_t name_offset, size_t name_length, size_t hash)
+    : name_offset_(name_offset), name_length_(name_length), hash_(hash) {
 }
 
-const std::string &SymbolTableEntry::GetName() const {
-    return name_;
+size_t SymbolTableEntry::GetHash() const {
+    return hash_;
+}
+
+bool SymbolTableEntry::IsLocal() const {
+    return depth_ > 0;
+}
+
+size_t SymbolTableEntry::GetFrameOffset() const {
+    return frame_offset_;
+}
+
+// 64-bit FNV-1a
+size_t SymbolTableEntry::Hash(std::string_view name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(hash);
+}
+
+SymbolTable::SymbolTable() : index_(kInitialIndexSize, kEmptySlot) {
+}
+
+size_t SymbolTable::Find(std::string_view name) const {
+    const size_t slot = probe(name, SymbolTableEntry::Hash(name));
+    const size_t id = index_[slot] == kEmptySlot ? SymbolTableEntry::kNoSymbol
+                                                 : visible(index_[slot]);
+    if (id == SymbolTableEntry::kNoSymbol) {
+        throw std::runtime_error("Symbol not found : " + std::string(name));
+    }
+    return id;
+}
+
+size_t SymbolTable::Add(std::string_view name) {
+    const size_t hash = SymbolTableEntry::Hash(name);
+    size_t slot = probe(name, hash);
+    size_t outer = SymbolTableEntry::kNoSymbol;
+    if (index_[slot] != kEmptySlot) {
+        outer = visible(index_[slot]);
+        if (outer != SymbolTableEntry::kNoSymbol && entries_[outer].depth_ == scopes_.size()) {
+            return outer;
+        }
+    } else {
+        if (2 * (index_used_ + 1) > index_.size()) {
+            grow();
+            slot = probe(name, hash);
+        }
+        ++index_used_;
+    }
+
+    const size_t id = entries_.size();
+    entries_.emplace_back(name_pool_.size(), name.size(), hash);
+    name_pool_.append(name);
+    auto &entry = entries_.back();
+    entry.shadowed_ = outer;
+    entry.depth_ = scopes_.size();
+    if (!scopes_.empty()) {
+        frame_offset_ += kSlotSize;
+        frame_size_ = std::max(frame_size_, frame_offset_);
+        entry.frame_offset_ = frame_offset_;
+        scopes_.back().symbols.push_back(id);
+    }
+    index_[slot] = id;
+    return id;
+}
+
+size_t SymbolTable::AddTemporary(std::string_view name) {
+    const size_t id = entries_.size();
+    entries_.emplace_back(name_pool_.size(), name.size(), SymbolTableEntry::Hash(name));
+    name_pool_.append(name);
+    auto &entry = entries_.back();
+    entry.depth_ = 1;
+    entry.in_scope_ = false;
+    frame_size_ += kSlotSize;
+    entry.frame_offset_ = frame_size_;
+    return id;
+}
+
+const SymbolTableEntry &SymbolTable::Get(size_t id) const {
+    return entries_.at(id);
+}
+
+std::string_view SymbolTable::GetName(size_t id) const {
+    return GetName(entries_.at(id));
+}
+
+std::string_view SymbolTable::GetName(const SymbolTableEntry &entry) const {
+    return std::string_view(name_pool_).substr(entry.name_offset_, entry.name_length_);
+}
+
+size_t SymbolTable::Size() const {
+    return entries_.size();
+}
+
+void SymbolTable::EnterScope() {
+    scopes_.push_back(Scope{{}, frame_offset_});
+}
+
+void SymbolTable::LeaveScope() {
+    if (scopes_.empty()) {
+        throw std::runtime_error("No scope to leave");
+    }
+    // The index keeps pointing at the dead declarations; visible() skips them.
+    for (const size_t id : scopes_.back().symbols) {
+        entries_[id].in_scope_ = false;
+    }
+    frame_offset_ = scopes_.back().frame_offset;
+    scopes_.pop_back();
+}
+
+size_t SymbolTable::GetFrameSize() const {
+    return frame_size_;
+}
+
+size_t SymbolTable::GetSlotCount() const {
+    return entries_.size() + frame_size_ / kSlotSize;
+}
+
+size_t SymbolTable::GetSlot(size_t id) const {
+    const auto &entry = entries_.at(id);
+    return entry.IsLocal() ? GetLocalSlot(entry.frame_offset_) : id;
+}
+
+size_t SymbolTable::GetLocalSlot(size_t frame_offset) const {
+    return entries_.size() + frame_offset / kSlotSize - 1;
+}
+
+// Returns the slot holding `name`, or the empty slot where it would be inserted.
+size_t SymbolTable::probe(std::string_view name, size_t hash) const {
+    const size_t mask = index_.size() - 1;
+    size_t slot = hash & mask;
+    while (index_[slot] != kEmptySlot) {
+        const auto &entry = entries_[index_[slot]];
+        if (entry.GetHash() == hash && GetName(entry) == name) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Innermost declaration, starting at `id`, whose scope is still open.
+size_t SymbolTable::visible(size_t id) const {
+    while (id != SymbolTableEntry::kNoSymbol && !entries_[id].in_scope_) {
+        id = entries_[id].shadowed_;
+    }
+    return id;
+}
+
+void SymbolTable::grow() {
+    std::vector<size_t> index(index_.size() * 2, kEmptySlot);
+    index.swap(index_);
+    const size_t mask = index_.size() - 1;
+    for (const size_t id : index) {
+        if (id == kEmptySlot) {
+            continue;
+        }
+        size_t slot = entries_[id].GetHash() & mask;
+        while (index_[slot] != kEmptySlot) {
+            slot = (slot + 1) & mask;
+        }
+        index_[slot] = id;
+    }
 }
 }
@@ -3,6 +3,8 @@
 // Standard includes
 // C++ Standard
 #include <string>
+#include <string_view>
+#include <vector>
 // C Standard
 #include <cstddef>
 
@@ -10,12 +12,86 @@ namespace my_cpp {
 
 class SymbolTableEntry {
 public:
-    SymbolTableEntry(const std::string &name);
+    static constexpr size_t kNoSymbol = static_cast<size_t>(-1);
+
+    SymbolTableEntry(size_t name_offset, size_t name_length, size_t hash);
     ~SymbolTableEntry() = default;
-    const std::string &GetName() const;
+    size_t GetHash() const;
+    bool IsLocal() const;
+    // Distance below %rbp of a local's 8-byte stack slot.
+    size_t GetFrameOffset() const;
+
+    static size_t Hash(std::string_view name);
+
+private:
+    friend class SymbolTable;
+
+    // The name is stored in the owning SymbolTable's name pool.
+    size_t name_offset_;
+    size_t name_length_;
+    size_t hash_;
+    // Number of scopes open at the declaration; 0 for globals.
+    size_t depth_ = 0;
+    size_t frame_offset_ = 0;
+    // While in scope, the declaration of the same name that this one hides.
+    size_t shadowed_ = kNoSymbol;
+    bool in_scope_ = true;
+};
+
+// Dense vector of symbols (indexed by symbol id) with an open-addressing hash index on the side.
+// Symbols declared while no scope is open are globals; symbols declared inside a scope are locals
+// laid out in the stack frame and hide outer declarations of the same name until LeaveScope().
+class SymbolTable {
+public:
+    SymbolTable();
+    size_t Find(std::string_view name) const;
+    size_t Add(std::string_view name);
+    // A local for the compiler's own use, in a frame slot past every scope's, that no name finds.
+    // Only for after parsing, when no scope can grow into that slot any more.
+    size_t AddTemporary(std::string_view name);
+    const SymbolTableEntry &Get(size_t id) const;
+    // The view stays valid until the next Add().
+    std::string_view GetName(size_t id) const;
+    std::string_view GetName(const SymbolTableEntry &entry) const;
+    size_t Size() const;
+
+    void EnterScope();
+    void LeaveScope();
+    // Bytes of stack needed by the locals of the deepest nest of scopes seen so far.
+    size_t GetFrameSize() const;
+
+    // Size of every local's frame slot.
+    static constexpr size_t kSlotSize = 8;
+
+    // Flat variable layout shared by the in-process engines: globals by symbol id, followed by
+    // one slot per 8-byte frame slot for the locals.
+    size_t GetSlotCount() const;
+    size_t GetSlot(size_t id) const;
+    size_t GetLocalSlot(size_t frame_offset) const;
 
 private:
-    std::string name_;
+    static constexpr size_t kEmptySlot = static_cast<size_t>(-1);
+    static constexpr size_t kInitialIndexSize = 64;
+
+    struct Scope {
+        std::vector<size_t> symbols;
+        size_t frame_offset;
+    };
+
+    std::vector<SymbolTableEntry> entries_;
+    // Every name back to back, appended on declaration and never rewritten.
+    std::string name_pool_;
+    // Linear probing index from a name to its most recent declaration. The size is always a power
+    // of two and the load factor is kept below 1/2 so that probe sequences stay short.
+    std::vector<size_t> index_;
+    size_t index_used_ = 0;
+    std::vector<Scope> scopes_;
+    size_t frame_offset_ = 0;
+    size_t frame_size_ = 0;
+
+    size_t probe(std::string_view name, size_t hash) const;
+    size_t visible(size_t id) const;
+    void grow();
 };
 
-}
\ No newline at end of file
+}
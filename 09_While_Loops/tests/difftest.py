@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Differential test: compiles each program to x86-64 assembly, assembles and runs it, and checks
+its output against the tree-walking interpreter (--run -O0) on the same program.
+
+    difftest.py <my_cpp> [--flags "<compiler flags>"] <program> [<program> ...]
+
+A program that stops on a division fault under the interpreter must also stop natively; its
+native output is then only checked to be a prefix, since printf's buffer dies with the process.
+
+A program with a <name>.expected file next to it must print exactly that, natively and under each
+of ENGINES with the same flags. This pins down behaviour the engines could all get wrong alike,
+such as the value of a local read before it is assigned.
+"""
+import argparse
+import concurrent.futures
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+TIMEOUT = 60
+ENGINES = ["--run", "--vm", "--closure", "--jit", "--tiered"]
+
+
+def run(command, cwd):
+    return subprocess.run(command, cwd=cwd, capture_output=True, text=True, timeout=TIMEOUT)
+
+
+def expected_path(program):
+    return os.path.splitext(program)[0] + ".expected"
+
+
+def expected_output(program):
+    """The output the program must print, if it has a .expected file."""
+    if not os.path.exists(expected_path(program)):
+        return None
+    with open(expected_path(program)) as f:
+        return f.read()
+
+
+def check(compiler, program, flags=()):
+    """Returns None if the native program behaves like the interpreter, else what differed."""
+    program = os.path.abspath(program)
+    with tempfile.TemporaryDirectory() as work:
+        expected = run([compiler, "--run", "-O0", program], work)
+        compiled = run([compiler, *flags, program], work)
+        if compiled.returncode != 0:
+            return "compile failed: " + compiled.stderr.strip()
+        cc = os.environ.get("CC", "cc")
+        assembled = run([cc, "-o", "a.out", "out.s"], work)
+        if assembled.returncode != 0:
+            return "assembly failed: " + assembled.stderr.strip()
+        native = run([os.path.join(work, "a.out")], work)
+        wanted = expected_output(program)
+        if wanted is not None:
+            if native.stdout != wanted:
+                return "native output differs from %s" % os.path.basename(expected_path(program))
+            for engine in ENGINES:
+                ran = run([compiler, *flags, engine, program], work)
+                if ran.stdout != wanted:
+                    return "%s output differs from %s" % (
+                        engine, os.path.basename(expected_path(program)))
+    if expected.returncode != 0:
+        if native.returncode == 0:
+            return "ran to the end where the interpreter stopped: " + expected.stderr.strip()
+        if not expected.stdout.startswith(native.stdout):
+            return "output before the fault differs"
+        return None
+    if native.returncode != 0:
+        return "exited with %d" % native.returncode
+    if native.stdout != expected.stdout:
+        got, want = native.stdout.splitlines(), expected.stdout.splitlines()
+        for line, (a, b) in enumerate(zip(got, want), 1):
+            if a != b:
+                return "line %d: got %s, expected %s" % (line, a, b)
+        return "got %d lines, expected %d" % (len(got), len(want))
+    return None
+
+
+def check_all(compiler, programs, flags=()):
+    """Checks every program, printing the failures; returns how many failed."""
+    with concurrent.futures.ThreadPoolExecutor(os.cpu_count()) as pool:
+        results = pool.map(lambda program: check(compiler, program, flags), programs)
+        failures = 0
+        for program, error in zip(programs, results):
+            if error is not None:
+                print("FAIL %s %s: %s" % (program, " ".join(flags), error))
+                failures += 1
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("compiler")
+    parser.add_argument("--flags", default="")
+    parser.add_argument("programs", nargs="+")
+    args = parser.parse_args()
+    failures = check_all(os.path.abspath(args.compiler), args.programs, shlex.split(args.flags))
+    print("%d of %d programs failed" % (failures, len(args.programs)))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
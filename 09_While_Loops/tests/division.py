@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Checks division by constants, which x86 lowers to multiplications and shifts, against the
+interpreter's idivq semantics (truncation toward zero, 64-bit wraparound).
+
+    division.py <my_cpp>
+
+Every divisor below divides every edge dividend and its neighbours, with and without -O0. The
+dividends vary in a loop so that the optimizer cannot fold the quotients away; each dividend's
+quotients are hashed and the hash printed, in full 64 bits, for difftest to compare.
+"""
+import os
+import sys
+import tempfile
+
+import difftest
+
+INT64_MIN = -(1 << 63)
+INT64_MAX = (1 << 63) - 1
+
+
+def dividends():
+    edges = {0, 1, INT64_MAX, INT64_MIN, INT64_MIN + 1, 10 ** 18, -10 ** 18}
+    for k in range(64):
+        edges |= {1 << k, -(1 << k)}
+    edges |= {(1 << 31) - 1, -(1 << 31), (1 << 32) - 1, 3 << 61, 6364136223846793005}
+    return sorted(e for e in edges if INT64_MIN <= e <= INT64_MAX)
+
+
+def divisors():
+    values = {1, -1, 2, -2, 3, -3, 5, -5, 6, 7, -7, 10, 25, 60, 100, 641, 1000, 86400,
+              1000000007, -1000000007, (1 << 31) - 1, -(1 << 31) + 1, -(1 << 31),
+              INT64_MAX, INT64_MIN, INT64_MIN + 1, 1 << 32, -(1 << 40) - 1, 3 << 61}
+    for k in range(1, 31):
+        values |= {1 << k, -(1 << k), (1 << k) + 1, (1 << k) - 1, -(1 << k) - 1}
+    return sorted(values)
+
+
+def literal(name, value):
+    """Builds a 64-bit value from 16-bit pieces: literals are ints and there is no unary minus."""
+    value &= (1 << 64) - 1
+    pieces = [(value >> shift) & 0xffff for shift in (48, 32, 16, 0)]
+    code = "%s = %d;" % (name, pieces[0])
+    for piece in pieces[1:]:
+        code += " %s = %s * 65536 + %d;" % (name, name, piece)
+    return code
+
+
+def divisor_operand(index, value):
+    """A small positive divisor stays a literal; any other comes from a variable set once."""
+    if 0 < value < (1 << 31):
+        return str(value)
+    return "d%d" % index
+
+
+def program():
+    lines = ["{", "int x; int i; int h; int q; int lowest;"]
+    edges, divs = dividends(), divisors()
+    lines += ["int v%d;" % j for j in range(len(edges))]
+    lines += ["int d%d;" % j for j in range(len(divs))]
+    lines.append(literal("lowest", INT64_MIN))
+    lines += [literal("v%d" % j, value) for j, value in enumerate(edges)]
+    lines += [literal("d%d" % j, value) for j, value in enumerate(divs)
+              if divisor_operand(j, value) != str(value)]
+    for j in range(len(edges)):
+        lines.append("i = 0;")
+        lines.append("while (i < 3) {")
+        lines.append("    x = v%d + i - 1;" % j)
+        lines.append("    h = 0;")
+        for k, value in enumerate(divs):
+            operand = divisor_operand(k, value)
+            if value == -1:
+                # The one quotient that does not fit faults.
+                lines.append("    if (x != lowest) { q = x / %s; h = h * 31 + q; }" % operand)
+            else:
+                lines.append("    q = x / %s; h = h * 31 + q;" % operand)
+        lines.append("    print h;")
+        lines.append("    print h / 65536 / 65536;")
+        lines.append("    i = i + 1;")
+        lines.append("}")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("usage: division.py <my_cpp>")
+        return 2
+    compiler = os.path.abspath(sys.argv[1])
+    with tempfile.TemporaryDirectory() as work:
+        path = os.path.join(work, "division.txt")
+        with open(path, "w") as source:
+            source.write(program())
+        failures = 0
+        for flags in ((), ("-O0",)):
+            failures += difftest.check_all(compiler, [path], flags)
+    print("division: %d of 2 runs failed" % failures)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Random differential testing: generates programs from seeds and checks each with difftest.
+
+    fuzz.py <my_cpp> [--seeds <count>] [--first <seed>] [--flags "<compiler flags>"] [--keep <dir>]
+
+The programs mix declarations, assignments, prints, single-store ifs (what if-conversion turns
+into selects), nested if/else and counted while loops. Divisions are by positive literals or by
+variables under an `if (v != 0)` guard. With --keep the programs are written to that directory,
+named seed<N>.txt, instead of a temporary one.
+"""
+import argparse
+import os
+import random
+import shlex
+import sys
+import tempfile
+
+import difftest
+
+LITERALS = [0, 1, 2, 3, 4, 5, 7, 8, 9, 10, 16, 17, 100, 1000, 65536]
+DIVISORS = [1, 2, 3, 4, 5, 7, 8, 10, 16, 25, 64, 1000]
+COMPARISONS = ["<", ">", "<=", ">=", "==", "!="]
+
+
+class Generator:
+    def __init__(self, seed):
+        self.random = random.Random(seed)
+        self.names = 0
+
+    def fresh(self, prefix):
+        self.names += 1
+        return "%s%d" % (prefix, self.names)
+
+    def expression(self, variables, depth=0):
+        if depth > 3 or self.random.random() < 0.3:
+            if variables and self.random.random() < 0.6:
+                return self.random.choice(variables)
+            return str(self.random.choice(LITERALS + [self.random.randint(0, 100000)]))
+        op = self.random.choice(["+", "-", "*", "/", "+", "-", "*"])
+        left = self.expression(variables, depth + 1)
+        # Comparisons bind tighter than arithmetic and there are no parentheses, so a divisor is
+        # a single operand.
+        right = str(self.random.choice(DIVISORS)) if op == "/" else \
+            self.expression(variables, depth + 1)
+        return "%s %s %s" % (left, op, right)
+
+    def condition(self, variables):
+        # Any arithmetic would bind looser than the comparison, so both sides are leaves.
+        return "%s %s %s" % (self.expression(variables, 9), self.random.choice(COMPARISONS),
+                             self.expression(variables, 9))
+
+    def small_if(self, variables):
+        target = self.random.choice(variables)
+        other = self.random.choice(variables) if self.random.random() < 0.8 else target
+        if self.random.random() < 0.2:
+            divisor = self.random.choice(variables)
+            return "if (%s != 0) { %s = %s / %s; }" % (
+                divisor, target, self.expression(variables, 2), divisor)
+        then_arm = "%s = %s;" % (target, self.expression(variables)) \
+            if self.random.random() < 0.85 else ""
+        else_arm = "%s = %s;" % (other, self.expression(variables)) \
+            if self.random.random() < 0.7 else ""
+        if self.random.random() < 0.3:
+            then_arm, else_arm = else_arm, then_arm
+        code = "if (%s) { %s }" % (self.condition(variables), then_arm)
+        if else_arm or self.random.random() < 0.3:
+            code += " else { %s }" % else_arm
+        return code
+
+    def block(self, variables, depth, indent):
+        out = []
+        declared = []
+        for _ in range(self.random.randint(0, 2) if depth > 0 else self.random.randint(3, 6)):
+            # Locals sometimes shadow an outer variable.
+            shadows = variables and depth > 0 and self.random.random() < 0.3
+            name = self.random.choice(variables) if shadows else self.fresh("v")
+            initial = self.expression([v for v in variables + declared if v != name])
+            out.append(indent + "int %s;" % name)
+            out.append(indent + "%s = %s;" % (name, initial))
+            declared.append(name)
+        visible = list(dict.fromkeys(variables + declared))
+        for _ in range(self.random.randint(1, 5)):
+            kind = self.random.random()
+            if kind < 0.3 or depth >= 3:
+                if visible:
+                    out.append(indent + "%s = %s;" % (self.random.choice(visible),
+                                                      self.expression(visible)))
+            elif kind < 0.5:
+                out.append(indent + "print %s;" % self.expression(visible))
+            elif kind < 0.62 and visible:
+                out.append(indent + self.small_if(visible))
+            elif kind < 0.75:
+                out.append(indent + "if (%s) {" % self.condition(visible))
+                out += self.block(visible, depth + 1, indent + "  ")
+                if self.random.random() < 0.5:
+                    out.append(indent + "} else {")
+                    out += self.block(visible, depth + 1, indent + "  ")
+                out.append(indent + "}")
+            else:
+                counter = self.fresh("c")
+                out.append(indent + "int %s;" % counter)
+                out.append(indent + "%s = 0;" % counter)
+                out.append(indent + "while (%s < %d) {" % (counter, self.random.randint(0, 12)))
+                out += self.block(visible, depth + 1, indent + "  ")
+                out.append(indent + "  %s = %s + 1;" % (counter, counter))
+                out.append(indent + "}")
+        out.append(indent + "print %s;" % self.expression(visible))
+        return out
+
+
+def program(seed):
+    return "{\n" + "\n".join(Generator(seed).block([], 0, "  ")) + "\n}\n"
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("compiler")
+    parser.add_argument("--seeds", type=int, default=200)
+    parser.add_argument("--first", type=int, default=0)
+    parser.add_argument("--flags", default="")
+    parser.add_argument("--keep")
+    args = parser.parse_args()
+    with tempfile.TemporaryDirectory() as scratch:
+        work = args.keep or scratch
+        os.makedirs(work, exist_ok=True)
+        programs = []
+        for seed in range(args.first, args.first + args.seeds):
+            path = os.path.join(work, "seed%d.txt" % seed)
+            with open(path, "w") as source:
+                source.write(program(seed))
+            programs.append(path)
+        failures = difftest.check_all(os.path.abspath(args.compiler), programs,
+                                      shlex.split(args.flags))
+    print("%d of %d seeds failed" % (failures, args.seeds))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
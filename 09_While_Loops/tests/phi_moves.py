@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""Checks that leaving SSA leaves no copies inside loops that coalescing can do without.
+
+    phi_moves.py <my_cpp> <program> [<program> ...]
+
+A loop body is the IR from a label to the last branch or jump back to it. None of the given
+programs swaps or rotates values in a loop, so every phi in them can share its arguments'
+register and no body may contain a move.
+"""
+import os
+import re
+import subprocess
+import sys
+
+LABEL = re.compile(r"^(\.L\d+):$")
+BACK = re.compile(r"^\t(?:br\.\w+|jmp)\t.*?(\.L\d+)$")
+
+
+def loop_moves(ir):
+    """Yields (label, line) for each move in the body of a loop that branches back to label."""
+    lines = ir.splitlines()
+    heads = {}
+    for index, line in enumerate(lines):
+        label = LABEL.match(line)
+        if label:
+            heads[label.group(1)] = index
+            continue
+        back = BACK.match(line)
+        if back and back.group(1) in heads:
+            for body in lines[heads[back.group(1)]:index]:
+                if body.startswith("\tmove\t"):
+                    yield back.group(1), body.strip()
+
+
+def main():
+    if len(sys.argv) < 3:
+        print("usage: phi_moves.py <my_cpp> <program> [<program> ...]")
+        return 2
+    compiler = os.path.abspath(sys.argv[1])
+    failures = 0
+    for program in sys.argv[2:]:
+        ir = subprocess.run([compiler, "--dump-ir", program], capture_output=True, text=True,
+                            check=True).stdout
+        moves = sorted(set(loop_moves(ir)))
+        for label, move in moves:
+            print("%s: %s in the loop at %s" % (program, move, label))
+        failures += 1 if moves else 0
+    print("phi_moves: %d of %d programs failed" % (failures, len(sys.argv) - 2))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+#include "tiered.hpp"
+// Standard includes
+// C++ Standard
+// C Standard
+
+namespace my_cpp {
+TieredInterpreter::TieredInterpreter(
+        CompilationContext &context,
+        std::ostream &os,
+        size_t threshold)
+    : Interpreter(context, os),
+      mutable_context_(context),
+      threshold_(threshold),
+      no_listing_(nullptr) {
+}
+
+size_t TieredInterpreter::GetCompiledLoops() const {
+    return compiled_loops_;
+}
+
+void TieredInterpreter::exec_while(const ASTNode &while_stmt) {
+    auto &loop = loops_[&while_stmt];
+    if (loop.native == nullptr) {
+        while (eval(*while_stmt.GetLeft()) != 0) {
+            if (while_stmt.GetRight() != nullptr) {
+                exec(*while_stmt.GetRight());
+            }
+            if (++loop.back_edges < threshold_) {
+                continue;
+            }
+            loop.native = std::make_unique<CodeGeneratorJIT>(
+                    mutable_context_,
+                    no_listing_,
+                    output_,
+                    CodeGeneratorJIT::Linkage::kFragment);
+            loop.native->GenerateCode(while_stmt);
+            ++compiled_loops_;
+            break;
+        }
+        if (loop.native == nullptr) {
+            return;
+        }
+    }
+    // The native loop starts by re-testing the condition, exactly where the interpreter was.
+    loop.native->Run(slots_.data());
+}
+}  // namespace my_cpp
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "gen_jit.hpp"
+#include "interp.hpp"
+// Standard includes
+// C++ Standard
+#include <memory>
+#include <ostream>
+#include <unordered_map>
+// C Standard
+#include <cstddef>
+
+namespace my_cpp {
+// Interprets the program and counts back-edges per A_WHILE node. Once a loop has taken
+// `threshold` back-edges it is compiled to native code, and execution continues in it from the
+// loop head with the variables' current values (on-stack replacement through the shared slot
+// array). Later runs of that loop enter the native code directly.
+class TieredInterpreter : public Interpreter {
+public:
+    static constexpr size_t kDefaultThreshold = 1000;
+
+    TieredInterpreter(
+            CompilationContext &context,
+            std::ostream &os,
+            size_t threshold = kDefaultThreshold);
+    // How many loops were compiled to native code, reported by --stats.
+    size_t GetCompiledLoops() const;
+
+private:
+    struct Loop {
+        size_t back_edges = 0;
+        std::unique_ptr<CodeGeneratorJIT> native;
+    };
+
+    CompilationContext &mutable_context_;
+    const size_t threshold_;
+    std::ostream no_listing_;
+    std::unordered_map<const ASTNode *, Loop> loops_;
+    size_t compiled_loops_ = 0;
+
+    void exec_while(const ASTNode &while_stmt) override;
+};
+}  // namespace my_cpp
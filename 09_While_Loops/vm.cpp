@@ -0,0 +1,168 @@
+#include "vm.hpp"
+
+#include "arith.hpp"
+// Standard includes
+// C++ Standard
+#include <vector>
+// C Standard
+
+namespace my_cpp {
+VirtualMachine::VirtualMachine(std::ostream &os) : output_(os) {
+}
+
+void VirtualMachine::Run(const Bytecode &program) {
+    execute(program);
+    output_.Flush();
+}
+
+void VirtualMachine::execute(const Bytecode &program) {
+    std::vector<int64_t> regs(program.num_registers);
+    std::vector<int64_t> slots(program.num_slots);
+    int64_t *const r = regs.data();
+    int64_t *const slot = slots.data();
+    const Instruction *const code = program.code.data();
+    size_t pc = 0;
+
+#if MY_CPP_VM_THREADED
+    // Indexed by Opcode.
+    static const void *const kHandlers[] = {
+            &&op_kLoadInt, &&op_kLoad,   &&op_kStore,  &&op_kAdd,    &&op_kSub,    &&op_kMul,
+            &&op_kDiv,     &&op_kEq,     &&op_kNe,     &&op_kLt,     &&op_kGt,     &&op_kLe,
+            &&op_kGe,      &&op_kJumpEq, &&op_kJumpNe, &&op_kJumpLt, &&op_kJumpGt, &&op_kJumpLe,
+            &&op_kJumpGe,  &&op_kJump,   &&op_kPrint,  &&op_kHalt,
+    };
+    // Resolve every instruction's handler once so dispatch is a single indirect jump.
+    std::vector<const void *> threaded(program.code.size());
+    for (size_t i = 0; i < threaded.size(); ++i) {
+        threaded[i] = kHandlers[static_cast<size_t>(code[i].op)];
+    }
+#    define VM_CASE(name) op_##name:
+#    define VM_DISPATCH() goto *threaded[pc]
+#    define VM_NEXT() \
+        ++pc;         \
+        VM_DISPATCH()
+#    define VM_JUMP(target) \
+        pc = (target);      \
+        VM_DISPATCH()
+    VM_DISPATCH();
+#else
+#    define VM_CASE(name) case Opcode::name:
+#    define VM_NEXT() \
+        ++pc;         \
+        continue
+#    define VM_JUMP(target) \
+        pc = (target);      \
+        continue
+    for (;;) {
+        switch (code[pc].op) {
+#endif
+
+    VM_CASE(kLoadInt) {
+        r[code[pc].a] = code[pc].b;
+        VM_NEXT();
+    }
+    VM_CASE(kLoad) {
+        r[code[pc].a] = slot[code[pc].b];
+        VM_NEXT();
+    }
+    VM_CASE(kStore) {
+        slot[code[pc].b] = r[code[pc].a];
+        VM_NEXT();
+    }
+    VM_CASE(kAdd) {
+        r[code[pc].a] = arith::Add(r[code[pc].b], r[code[pc].c]);
+        VM_NEXT();
+    }
+    VM_CASE(kSub) {
+        r[code[pc].a] = arith::Sub(r[code[pc].b], r[code[pc].c]);
+        VM_NEXT();
+    }
+    VM_CASE(kMul) {
+        r[code[pc].a] = arith::Mul(r[code[pc].b], r[code[pc].c]);
+        VM_NEXT();
+    }
+    VM_CASE(kDiv) {
+        r[code[pc].a] = arith::Div(r[code[pc].b], r[code[pc].c]);
+        VM_NEXT();
+    }
+    VM_CASE(kEq) {
+        r[code[pc].a] = r[code[pc].b] == r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kNe) {
+        r[code[pc].a] = r[code[pc].b] != r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kLt) {
+        r[code[pc].a] = r[code[pc].b] < r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kGt) {
+        r[code[pc].a] = r[code[pc].b] > r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kLe) {
+        r[code[pc].a] = r[code[pc].b] <= r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kGe) {
+        r[code[pc].a] = r[code[pc].b] >= r[code[pc].c];
+        VM_NEXT();
+    }
+    VM_CASE(kJumpEq) {
+        if (r[code[pc].a] == r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJumpNe) {
+        if (r[code[pc].a] != r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJumpLt) {
+        if (r[code[pc].a] < r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJumpGt) {
+        if (r[code[pc].a] > r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJumpLe) {
+        if (r[code[pc].a] <= r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJumpGe) {
+        if (r[code[pc].a] >= r[code[pc].b]) {
+            VM_JUMP(code[pc].c);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(kJump) {
+        VM_JUMP(code[pc].c);
+    }
+    VM_CASE(kPrint) {
+        output_.PrintInt(r[code[pc].a]);
+        VM_NEXT();
+    }
+    VM_CASE(kHalt) {
+        return;
+    }
+
+#if !MY_CPP_VM_THREADED
+        }
+    }
+#endif
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_NEXT
+#undef VM_JUMP
+}
+}  // namespace my_cpp
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "output.hpp"
+// Standard includes
+// C++ Standard
+#include <ostream>
+// C Standard
+#include <cstddef>
+
+// Direct-threaded dispatch through computed goto where the compiler supports it; define
+// MY_CPP_VM_SWITCH_DISPATCH to force the portable switch loop.
+#if defined(__GNUC__) && !defined(MY_CPP_VM_SWITCH_DISPATCH)
+#    define MY_CPP_VM_THREADED 1
+#else
+#    define MY_CPP_VM_THREADED 0
+#endif
+
+namespace my_cpp {
+class VirtualMachine {
+public:
+    VirtualMachine(std::ostream &os);
+    void Run(const Bytecode &program);
+
+private:
+    OutputBuffer output_;
+
+    void execute(const Bytecode &program);
+};
+}  // namespace my_cpp